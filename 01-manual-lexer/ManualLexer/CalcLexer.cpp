@@ -1,58 +1,82 @@
 #include "CalcLexer.h"
+#include "CharClass.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
 
-namespace calc
+namespace calc::manual
 {
 namespace
 {
-bool IsDigit(char ch)
+std::optional<LexErrorKind> FindNumberError(std::string_view value)
 {
 	/*
-	 * Returns true if given character is digit.
+	 * Checks number token which has been read until the end.
+	 * Valid number has no leading zeros, no letters
+	 *  and at most one dot surrounded by digits.
+	 * Returns kind of the first error found.
 	 */
-	switch (ch)
+	if (value.front() == '.')
 	{
-	case '0':
-	case '1':
-	case '2':
-	case '3':
-	case '4':
-	case '5':
-	case '6':
-	case '7':
-	case '8':
-	case '9':
-		return true;
-	default:
-		return false;
+		return LexErrorKind::LeadingDot;
 	}
-}
-bool IsSpace(char ch)
-{
-	/*
-	 * Returns true if given character is space.
-	 */
-	switch (ch)
+	if (value.front() == '0' && value.size() > 1 && HasCharClass(value[1], CC_DIGIT))
 	{
-	case ' ':
-	case '\t':
-	case '\n':
-		return true;
-	default:
-		return false;
+		return LexErrorKind::LeadingZero;
 	}
-}
-bool IsChar(char ch)
-{
-	/* 
-	 * Returns true if given character is char a-z || A-Z || _
-	 */
-	return (ch >= 'a' && ch < 'z') || (ch >= 'A' && ch < 'Z') || ch == '_';
+	bool wasDot = false;
+	for (size_t i = 1; i < value.size(); ++i)
+	{
+		const char ch = value[i];
+		if (HasCharClass(ch, CC_ID_START))
+		{
+			return LexErrorKind::LetterInNumber;
+		}
+		if (ch == '.')
+		{
+			if (wasDot || !HasCharClass(value[i - 1], CC_DIGIT))
+			{
+				return LexErrorKind::DoubleDot;
+			}
+			if (i + 1 >= value.size())
+			{
+				return LexErrorKind::TrailingDot;
+			}
+			if (!HasCharClass(value[i + 1], CC_DIGIT))
+			{
+				return value[i + 1] == '.' ? LexErrorKind::DoubleDot : LexErrorKind::LetterInNumber;
+			}
+			wasDot = true;
+		}
+	}
+	return std::nullopt;
 }
 }
 
 CalcLexer::CalcLexer(std::string_view sources)
 	: m_sources(sources)
+	, m_scanners(&GetCharScanners())
+{
+}
+
+CalcLexer::CalcLexer(std::string_view sources, std::vector<LexError>& errors)
+	: m_sources(sources)
+	, m_scanners(&GetCharScanners())
+	, m_errors(&errors)
 {
+	CheckErrorOffsets();
+}
+
+void CalcLexer::Reset(std::string_view sources)
+{
+	m_sources = sources;
+	CheckErrorOffsets();
+	m_position = 0;
+}
+
+void CalcLexer::SetKeywords(const KeywordTable& keywords)
+{
+	m_keywords = &keywords;
 }
 
 Token CalcLexer::Read()
@@ -60,12 +84,88 @@ Token CalcLexer::Read()
 	/*
      * Reads next token from input string with following steps:
 	 * 1) skips whitespace characters
-	 * 2) checks for the end of input
-	 * 3) checks first character to select token type
-	 * 4) if token may have several characters, read them all
+	 * 2) remembers token start offset
+	 * 3) reads token itself
+	 * 4) in error-recovering mode, records malformed token and continues
 	 */
 
-	SkipSpaces();
+	for (;;)
+	{
+		SkipSpaces();
+
+		const size_t start = m_position;
+		Token token = ReadToken();
+		token.offset = start;
+		if (token.type != TT_ERROR || m_errors == nullptr)
+		{
+			return token;
+		}
+		RecordError(start);
+	}
+}
+
+size_t CalcLexer::ReadBatch(Token* out, size_t count)
+{
+	size_t read = 0;
+	while (read < count)
+	{
+		Token token = Read();
+		if (token.type == TT_END)
+		{
+			break;
+		}
+		out[read++] = token;
+	}
+	return read;
+}
+
+void CalcLexer::ReadAll(std::vector<Token>& tokens)
+{
+	tokens.clear();
+	for (Token token = Read(); token.type != TT_END; token = Read())
+	{
+		tokens.push_back(token);
+	}
+}
+
+void CalcLexer::ReadAll(TokenStream& stream)
+{
+	if (m_sources.size() > UINT32_MAX)
+	{
+		throw std::length_error("sources are too large for TokenStream");
+	}
+	stream.Clear();
+	for (Token token = Read(); token.type != TT_END; token = Read())
+	{
+		stream.Push(token.type, static_cast<uint32_t>(token.offset), static_cast<uint32_t>(m_position - token.offset));
+	}
+}
+
+void CalcLexer::CheckErrorOffsets() const
+{
+	if (m_errors != nullptr && m_sources.size() > UINT32_MAX)
+	{
+		throw std::length_error("sources are too large for LexError offsets");
+	}
+}
+
+void CalcLexer::RecordError(size_t start)
+{
+	for (size_t offset = start; offset < m_position; offset += UINT16_MAX)
+	{
+		const size_t length = std::min<size_t>(m_position - offset, UINT16_MAX);
+		m_errors->push_back(LexError{ static_cast<uint32_t>(offset), static_cast<uint16_t>(length), m_errorKind });
+	}
+}
+
+Token CalcLexer::ReadToken()
+{
+	/*
+	 * Reads token which starts at current position with following steps:
+	 * 1) checks for the end of input
+	 * 2) checks first character to select token type
+	 * 3) if token may have several characters, read them all
+	 */
 
 	if (m_position >= m_sources.size())
 	{
@@ -75,86 +175,49 @@ Token CalcLexer::Read()
 	char next = m_sources[m_position];
 	++m_position;
 
-	switch (next)
+	const uint8_t charClass = GetCharClass(next);
+	if (charClass & CC_OPERATOR)
 	{
-	case '+':
-		return Token{ TT_PLUS };
-	case '-':
-		return Token{ TT_MINUS };
-	case '*':
-		return Token{ TT_ASTERISK };
-	case '/':
-		return Token{ TT_SLASH };
-	case '=':
-		return Token{ TT_EQUAL };
-	case '(':
-		return Token{ TT_OPEN_BRACKET };
-	case ')':
-		return Token{ TT_CLOSE_BRACKET };
-	default:
-		break;
+		return Token{ GetOperatorToken(next) };
 	}
 
-	if (IsDigit(next) || next == '.')
+	if (charClass & CC_NUMBER_START)
 	{
-		return ReadNumber(next);
+		return ReadNumber();
 	}
 	
-	if (IsChar(next))
+	if (charClass & CC_ID_START)
 	{
-		return ReadId(next);
+		return ReadId();
 	}
 
+	m_errorKind = LexErrorKind::UnexpectedChar;
 	return Token{ TT_ERROR };
 }
 
 void CalcLexer::SkipSpaces()
 {
-	// TODO: skip whitespace characters - at least ' ', '\t' and '\n'.
-	while (m_position < m_sources.size() && IsSpace(m_sources[m_position]))
+	// Most of whitespace runs are one character long,
+	//  so vector scanner is used only when run continues.
+	if (m_position < m_sources.size() && HasCharClass(m_sources[m_position], CC_SPACE))
 	{
-		++m_position;
+		m_position = m_scanners->skipSpaces(m_sources.data(), m_sources.size(), m_position + 1);
 	}
 }
 
-Token CalcLexer::ReadNumber(char head)
+Token CalcLexer::ReadNumber()
 {
 	/*
 	 * Reads the tail of number token and returns this token.
 	 * PRECONDITION: first character already read and it's a number.
 	 * POSTCONDITION: all number characters have been read.
 	 */
-	std::string value;
-	value += head;
-	bool wasError = false;
-	bool wasDot = false;
-
-	wasError = wasError || head == '.';
-	wasError = wasError || (
-		head == '0'
-		&& m_position < m_sources.size()
-		&& (IsDigit(m_sources[m_position]) || IsChar(m_sources[m_position])));
-
-	while (m_position < m_sources.size() && (IsDigit(m_sources[m_position]) || m_sources[m_position] == '.' || IsChar(m_sources[m_position])))
-	{
-		char currentChar = m_sources[m_position];
-		if (!wasError)
-		{
-			wasError = wasError || IsChar(currentChar);
-			wasError = wasError || (currentChar == '.' && (
-				wasDot || 
-				!IsDigit(m_sources[m_position - 1]) || 
-				m_position + 1 >= m_sources.size() || 
-				!IsDigit(m_sources[m_position + 1])
-				));
-		}
-		wasDot = wasDot || currentChar == '.';
-		value += currentChar;
-		++m_position;
-	}
-	wasError = wasError || value[value.length() - 1] == '.'; // check for dot with last .
-	if (wasError)
+	const size_t start = m_position - 1;
+	m_position = m_scanners->skipNumberChars(m_sources.data(), m_sources.size(), m_position);
+	std::string_view value = m_sources.substr(start, m_position - start);
+	if (const auto error = FindNumberError(value))
 	{
+		m_errorKind = *error;
 		return Token{ TT_ERROR, value };
 	}
 	else
@@ -163,21 +226,24 @@ Token CalcLexer::ReadNumber(char head)
 	}
 }
 
-Token CalcLexer::ReadId(char head)
+Token CalcLexer::ReadId()
 {
 	/*
 	 * Reads the tail of id token and returns this token.
 	 * PRECONDITION: first character already read and it's a char.
-	 * POSTCONDITION: all number characters have been read.
+	 * POSTCONDITION: all id characters have been read.
+	 * Id followed by dot is read like a number and returned as error.
 	 */
-	std::string value;
-	value += head;
-	while (m_position < m_sources.length() && (IsChar(m_sources[m_position]) || IsDigit(m_sources[m_position])))
+	const size_t start = m_position - 1;
+	m_position = m_scanners->skipIdChars(m_sources.data(), m_sources.size(), m_position);
+	if (m_position < m_sources.size() && m_sources[m_position] == '.')
 	{
-		value += m_sources[m_position];
-		++m_position;
+		m_position = m_scanners->skipNumberChars(m_sources.data(), m_sources.size(), m_position);
+		m_errorKind = LexErrorKind::DotInId;
+		return Token{ TT_ERROR, m_sources.substr(start, m_position - start) };
 	}
-	return Token{ TT_ID, value };
+	const std::string_view value = m_sources.substr(start, m_position - start);
+	return Token{ m_keywords ? m_keywords->Find(value) : TT_ID, value };
 }
 
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <calc-common/KeywordTable.h>
+#include <calc-common/Token.h>
+#include <calc-common/TokenStream.h>
 #include <string_view>
-#include "Token.h"
+#include <vector>
+#include "CharScan.h"
+#include "LexError.h"
 
-namespace calc
+namespace calc::manual
 {
 
 class CalcLexer
@@ -11,15 +16,46 @@ class CalcLexer
 public:
 	CalcLexer(std::string_view sources);
 
+	// Creates lexer in error-recovering mode: malformed tokens are appended
+	//  to `errors` and skipped, so Read never returns TT_ERROR.
+	// Throws std::length_error if sources don't fit 32-bit error offsets.
+	CalcLexer(std::string_view sources, std::vector<LexError>& errors);
+
+	// Restarts lexer on new `sources`, keeping error list, keywords and scanners.
+	// Throws std::length_error in error-recovering mode, like the constructor.
+	void Reset(std::string_view sources);
+
+	// Makes lexer return keyword types for ids found in `keywords`.
+	// `keywords` must outlive lexer.
+	void SetKeywords(const KeywordTable& keywords);
+
 	Token Read();
 
+	// Reads up to `count` tokens into `out` and returns number of tokens read.
+	// TT_END is not stored, so result less than `count` means end of input.
+	size_t ReadBatch(Token* out, size_t count);
+
+	// Reads all remaining tokens into `tokens`, reusing its capacity.
+	void ReadAll(std::vector<Token>& tokens);
+
+	// Reads all remaining tokens into compact `stream`, reusing its capacity.
+	// Throws std::length_error if sources don't fit 32-bit offsets.
+	void ReadAll(TokenStream& stream);
+
 private:
+	void CheckErrorOffsets() const;
+	void RecordError(size_t start);
 	void SkipSpaces();
-	Token ReadNumber(char head);
-	Token ReadId(char head);
+	Token ReadToken();
+	Token ReadNumber();
+	Token ReadId();
 
 	std::string_view m_sources;
 	size_t m_position = 0;
+	const CharScanners* m_scanners = nullptr;
+	std::vector<LexError>* m_errors = nullptr;
+	const KeywordTable* m_keywords = nullptr;
+	LexErrorKind m_errorKind = LexErrorKind::UnexpectedChar; // kind of last TT_ERROR token
 };
 
 }
@@ -0,0 +1,73 @@
+#include "CalcStreamLexer.h"
+#include "CalcLexer.h"
+#include "CharClass.h"
+
+namespace calc::manual
+{
+namespace
+{
+bool IsWordChar(char ch)
+{
+	/*
+	 * Returns true if given character may continue multi-character token.
+	 * Other characters always end the token before them.
+	 */
+	return HasCharClass(ch, CC_NUMBER_CONTINUE);
+}
+}
+
+void CalcStreamLexer::Feed(std::string_view chunk, std::vector<Token>& tokens)
+{
+	/*
+	 * Splits chunk into three parts:
+	 * 1) head which completes the tail of previous chunks
+	 * 2) body which can be lexed in place
+	 * 3) tail which may be continued by next chunk
+	 */
+	size_t bodyStart = 0;
+	if (!m_tail.empty())
+	{
+		while (bodyStart < chunk.size() && IsWordChar(chunk[bodyStart]))
+		{
+			++bodyStart;
+		}
+		if (bodyStart == chunk.size())
+		{
+			m_tail.append(chunk.data(), chunk.size());
+			m_consumed += chunk.size();
+			return;
+		}
+		m_joined.assign(m_tail);
+		m_joined.append(chunk.data(), bodyStart);
+		ReadTokens(m_joined, m_consumed - m_tail.size(), tokens);
+		m_tail.clear();
+	}
+
+	size_t tailStart = chunk.size();
+	while (tailStart > bodyStart && IsWordChar(chunk[tailStart - 1]))
+	{
+		--tailStart;
+	}
+	ReadTokens(chunk.substr(bodyStart, tailStart - bodyStart), m_consumed + bodyStart, tokens);
+	m_tail.assign(chunk.data() + tailStart, chunk.size() - tailStart);
+	m_consumed += chunk.size();
+}
+
+void CalcStreamLexer::Finish(std::vector<Token>& tokens)
+{
+	m_joined.swap(m_tail);
+	m_tail.clear();
+	ReadTokens(m_joined, m_consumed - m_joined.size(), tokens);
+}
+
+void CalcStreamLexer::ReadTokens(std::string_view text, size_t offset, std::vector<Token>& tokens)
+{
+	CalcLexer lexer{ text };
+	for (Token token = lexer.Read(); token.type != TT_END; token = lexer.Read())
+	{
+		token.offset += offset;
+		tokens.push_back(token);
+	}
+}
+
+}
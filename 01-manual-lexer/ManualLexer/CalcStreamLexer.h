@@ -0,0 +1,37 @@
+#pragma once
+
+#include <calc-common/Token.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace calc::manual
+{
+
+/*
+ * Push-style lexer for input which arrives in chunks.
+ * Token may be split between chunks, so the unfinished tail of a chunk
+ *  (run of id and number characters) is kept until next chunk completes it.
+ * Memory usage is bounded by the longest token, not by the input size.
+ */
+class CalcStreamLexer
+{
+public:
+	// Lexes next chunk and appends all completed tokens to `tokens`.
+	// Token values point into `chunk` or into lexer's own buffer,
+	//  they stay valid until the next call of Feed or Finish.
+	// Token offsets are counted from the start of the whole stream.
+	void Feed(std::string_view chunk, std::vector<Token>& tokens);
+
+	// Flushes token which was held at the end of input.
+	void Finish(std::vector<Token>& tokens);
+
+private:
+	static void ReadTokens(std::string_view text, size_t offset, std::vector<Token>& tokens);
+
+	size_t m_consumed = 0; // total size of all chunks fed before current
+	std::string m_tail;
+	std::string m_joined;
+};
+
+}
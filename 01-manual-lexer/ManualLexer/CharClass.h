@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <calc-common/Token.h>
+#include <cstdint>
+
+namespace calc::manual
+{
+
+enum CharClass : uint8_t
+{
+	CC_NONE = 0,
+	CC_SPACE = 1 << 0,
+	CC_DIGIT = 1 << 1,
+	CC_ID_START = 1 << 2,
+	CC_ID_CONTINUE = 1 << 3,
+	CC_NUMBER_START = 1 << 4,
+	CC_NUMBER_CONTINUE = 1 << 5,
+	CC_OPERATOR = 1 << 6,
+};
+
+namespace detail
+{
+constexpr std::array<uint8_t, 256> MakeCharClassTable()
+{
+	/*
+	 * Builds class flags for every byte value at compile time.
+	 * Bytes above 127 have no class and are lexed as errors.
+	 */
+	std::array<uint8_t, 256> table{};
+	table[' '] = table['\t'] = table['\r'] = table['\n'] = CC_SPACE;
+	for (char ch = '0'; ch <= '9'; ++ch)
+	{
+		table[ch] = CC_DIGIT | CC_ID_CONTINUE | CC_NUMBER_START | CC_NUMBER_CONTINUE;
+	}
+	for (char ch = 'a'; ch <= 'z'; ++ch)
+	{
+		table[ch] = CC_ID_START | CC_ID_CONTINUE | CC_NUMBER_CONTINUE;
+		table[ch - 'a' + 'A'] = CC_ID_START | CC_ID_CONTINUE | CC_NUMBER_CONTINUE;
+	}
+	table['_'] = CC_ID_START | CC_ID_CONTINUE | CC_NUMBER_CONTINUE;
+	table['.'] = CC_NUMBER_START | CC_NUMBER_CONTINUE;
+	for (char ch : { '+', '-', '*', '/', '=', '(', ')' })
+	{
+		table[ch] = CC_OPERATOR;
+	}
+	return table;
+}
+
+constexpr std::array<TokenType, 256> MakeOperatorTable()
+{
+	std::array<TokenType, 256> table{};
+	table['+'] = TT_PLUS;
+	table['-'] = TT_MINUS;
+	table['*'] = TT_ASTERISK;
+	table['/'] = TT_SLASH;
+	table['='] = TT_EQUAL;
+	table['('] = TT_OPEN_BRACKET;
+	table[')'] = TT_CLOSE_BRACKET;
+	return table;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASS_TABLE = MakeCharClassTable();
+constexpr std::array<TokenType, 256> OPERATOR_TABLE = MakeOperatorTable();
+}
+
+inline uint8_t GetCharClass(char ch)
+{
+	return detail::CHAR_CLASS_TABLE[static_cast<unsigned char>(ch)];
+}
+
+inline bool HasCharClass(char ch, uint8_t flags)
+{
+	return (GetCharClass(ch) & flags) != 0;
+}
+
+// Returns operator token type for character with CC_OPERATOR class.
+inline TokenType GetOperatorToken(char ch)
+{
+	return detail::OPERATOR_TABLE[static_cast<unsigned char>(ch)];
+}
+
+}
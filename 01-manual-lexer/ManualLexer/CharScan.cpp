@@ -0,0 +1,283 @@
+#include "CharScan.h"
+#include "CharClass.h"
+#include <cassert>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CALC_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(CALC_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CALC_TARGET(name) __attribute__((target(name)))
+#else
+#define CALC_TARGET(name)
+#endif
+
+namespace calc::manual
+{
+namespace
+{
+template <uint8_t Flags>
+size_t SkipScalar(const char* data, size_t size, size_t position)
+{
+	while (position < size && HasCharClass(data[position], Flags))
+	{
+		++position;
+	}
+	return position;
+}
+
+#if defined(CALC_SCAN_X86)
+size_t CountTrailingZeros(unsigned mask)
+{
+	/*
+	 * PRECONDITION: mask is not zero.
+	 */
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return static_cast<size_t>(__builtin_ctz(mask));
+#endif
+}
+
+// Character classes below are computed with signed byte comparison,
+//  so bytes above 127 are negative and never match any class.
+
+CALC_TARGET("sse2")
+__m128i InRange128(__m128i chars, char low, char high)
+{
+	return _mm_and_si128(
+		_mm_cmpgt_epi8(chars, _mm_set1_epi8(low - 1)),
+		_mm_cmplt_epi8(chars, _mm_set1_epi8(high + 1)));
+}
+
+CALC_TARGET("sse2")
+__m128i SpaceMask128(__m128i chars)
+{
+	return _mm_or_si128(
+		_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')),
+		_mm_or_si128(
+			_mm_cmpeq_epi8(chars, _mm_set1_epi8('\t')),
+			_mm_or_si128(
+				_mm_cmpeq_epi8(chars, _mm_set1_epi8('\r')),
+				_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')))));
+}
+
+CALC_TARGET("sse2")
+__m128i IdMask128(__m128i chars)
+{
+	const __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+	return _mm_or_si128(
+		_mm_or_si128(InRange128(chars, '0', '9'), InRange128(lower, 'a', 'z')),
+		_mm_cmpeq_epi8(chars, _mm_set1_epi8('_')));
+}
+
+CALC_TARGET("sse2")
+__m128i NumberMask128(__m128i chars)
+{
+	return _mm_or_si128(IdMask128(chars), _mm_cmpeq_epi8(chars, _mm_set1_epi8('.')));
+}
+
+template <__m128i (*Mask)(__m128i), uint8_t Flags>
+CALC_TARGET("sse2")
+size_t SkipSse2(const char* data, size_t size, size_t position)
+{
+	while (position + 16 <= size)
+	{
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+		const unsigned mismatch = ~static_cast<unsigned>(_mm_movemask_epi8(Mask(chars))) & 0xFFFFu;
+		if (mismatch != 0)
+		{
+			return position + CountTrailingZeros(mismatch);
+		}
+		position += 16;
+	}
+	return SkipScalar<Flags>(data, size, position);
+}
+
+CALC_TARGET("avx2")
+__m256i InRange256(__m256i chars, char low, char high)
+{
+	return _mm256_and_si256(
+		_mm256_cmpgt_epi8(chars, _mm256_set1_epi8(low - 1)),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chars));
+}
+
+CALC_TARGET("avx2")
+__m256i SpaceMask256(__m256i chars)
+{
+	return _mm256_or_si256(
+		_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')),
+		_mm256_or_si256(
+			_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\t')),
+			_mm256_or_si256(
+				_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\r')),
+				_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n')))));
+}
+
+CALC_TARGET("avx2")
+__m256i IdMask256(__m256i chars)
+{
+	const __m256i lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+	return _mm256_or_si256(
+		_mm256_or_si256(InRange256(chars, '0', '9'), InRange256(lower, 'a', 'z')),
+		_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('_')));
+}
+
+CALC_TARGET("avx2")
+__m256i NumberMask256(__m256i chars)
+{
+	return _mm256_or_si256(IdMask256(chars), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('.')));
+}
+
+template <__m256i (*Mask)(__m256i), __m128i (*Mask128)(__m128i), uint8_t Flags>
+CALC_TARGET("avx2")
+size_t SkipAvx2(const char* data, size_t size, size_t position)
+{
+	while (position + 32 <= size)
+	{
+		const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+		const unsigned mismatch = ~static_cast<unsigned>(_mm256_movemask_epi8(Mask(chars)));
+		if (mismatch != 0)
+		{
+			return position + CountTrailingZeros(mismatch);
+		}
+		position += 32;
+	}
+	return SkipSse2<Mask128, Flags>(data, size, position);
+}
+
+void GetCpuId(int info[4], int function)
+{
+#if defined(_MSC_VER)
+	__cpuidex(info, function, 0);
+#else
+	unsigned regs[4] = {};
+	__cpuid_count(function, 0, regs[0], regs[1], regs[2], regs[3]);
+	for (int i = 0; i < 4; ++i)
+	{
+		info[i] = static_cast<int>(regs[i]);
+	}
+#endif
+}
+
+unsigned long long GetEnabledXStateFeatures()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned eax = 0;
+	unsigned edx = 0;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+bool HasSse2()
+{
+	int info[4] = {};
+	GetCpuId(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+}
+
+bool HasAvx2()
+{
+	/*
+	 * AVX2 requires CPU support (CPUID leaf 7) and OS support
+	 *  for saving YMM registers (OSXSAVE and XCR0 bits 1 and 2).
+	 */
+	int info[4] = {};
+	GetCpuId(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+	GetCpuId(info, 1);
+	const bool hasOsXSave = (info[2] & (1 << 27)) != 0;
+	const bool hasAvx = (info[2] & (1 << 28)) != 0;
+	if (!hasOsXSave || !hasAvx || (GetEnabledXStateFeatures() & 0x6) != 0x6)
+	{
+		return false;
+	}
+	GetCpuId(info, 7);
+	return (info[1] & (1 << 5)) != 0;
+}
+#endif
+
+const CharScanners SCALAR_SCANNERS = {
+	SkipScalar<CC_SPACE>,
+	SkipScalar<CC_ID_CONTINUE>,
+	SkipScalar<CC_NUMBER_CONTINUE>,
+};
+
+#if defined(CALC_SCAN_X86)
+const CharScanners SSE2_SCANNERS = {
+	SkipSse2<SpaceMask128, CC_SPACE>,
+	SkipSse2<IdMask128, CC_ID_CONTINUE>,
+	SkipSse2<NumberMask128, CC_NUMBER_CONTINUE>,
+};
+
+const CharScanners AVX2_SCANNERS = {
+	SkipAvx2<SpaceMask256, SpaceMask128, CC_SPACE>,
+	SkipAvx2<IdMask256, IdMask128, CC_ID_CONTINUE>,
+	SkipAvx2<NumberMask256, NumberMask128, CC_NUMBER_CONTINUE>,
+};
+#endif
+}
+
+bool IsScanKernelSupported(ScanKernel kernel)
+{
+	switch (kernel)
+	{
+	case ScanKernel::Scalar:
+		return true;
+#if defined(CALC_SCAN_X86)
+	case ScanKernel::Sse2:
+	{
+		static const bool supported = HasSse2();
+		return supported;
+	}
+	case ScanKernel::Avx2:
+	{
+		static const bool supported = HasSse2() && HasAvx2();
+		return supported;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const CharScanners& GetCharScanners(ScanKernel kernel)
+{
+	assert(IsScanKernelSupported(kernel));
+	switch (kernel)
+	{
+#if defined(CALC_SCAN_X86)
+	case ScanKernel::Sse2:
+		return SSE2_SCANNERS;
+	case ScanKernel::Avx2:
+		return AVX2_SCANNERS;
+#endif
+	default:
+		return SCALAR_SCANNERS;
+	}
+}
+
+const CharScanners& GetCharScanners()
+{
+	static const CharScanners& best = GetCharScanners(
+		IsScanKernelSupported(ScanKernel::Avx2) ? ScanKernel::Avx2
+		: IsScanKernelSupported(ScanKernel::Sse2) ? ScanKernel::Sse2
+		: ScanKernel::Scalar);
+	return best;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace calc::manual
+{
+
+/*
+ * Scanners find the end of a run of characters of the same kind.
+ * Each scanner returns position of the first character at or after `position`
+ *  which doesn't belong to the run, or `size` if run lasts until the end.
+ */
+using ScanFunction = size_t (*)(const char* data, size_t size, size_t position);
+
+struct CharScanners
+{
+	ScanFunction skipSpaces = nullptr;   // ' ', '\t', '\r', '\n'
+	ScanFunction skipIdChars = nullptr;  // [a-zA-Z0-9_]
+	ScanFunction skipNumberChars = nullptr; // [a-zA-Z0-9_.]
+};
+
+enum class ScanKernel
+{
+	Scalar,
+	Sse2,
+	Avx2,
+};
+
+// Returns true if kernel is compiled in and supported by current CPU.
+bool IsScanKernelSupported(ScanKernel kernel);
+
+// Returns scanners for given kernel, kernel must be supported.
+const CharScanners& GetCharScanners(ScanKernel kernel);
+
+// Returns scanners for the best kernel supported by current CPU,
+//  selected once via CPUID.
+const CharScanners& GetCharScanners();
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace calc::manual
+{
+
+enum class LexErrorKind : uint8_t
+{
+	LeadingZero,    // 0123
+	LeadingDot,     // .5
+	DoubleDot,      // 1..2, 1.2.3
+	TrailingDot,    // 5.
+	LetterInNumber, // 0x1, 5abc
+	DotInId,        // a.b, x.
+	UnexpectedChar, // #
+};
+
+// Malformed token span, recorded instead of TT_ERROR token.
+// Offsets are 32-bit like in TokenStream, so sources are limited to 4GB.
+// Span longer than UINT16_MAX is recorded as several adjacent errors of the same kind.
+struct LexError
+{
+	uint32_t offset = 0;
+	uint16_t length = 0;
+	LexErrorKind kind = LexErrorKind::UnexpectedChar;
+};
+
+static_assert(sizeof(LexError) == 8, "LexError must stay compact");
+
+}
@@ -0,0 +1,69 @@
+#include "ParallelLexer.h"
+#include "CalcLexer.h"
+#include "CharClass.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace calc::manual
+{
+namespace
+{
+std::vector<size_t> SplitAtSpaces(std::string_view sources, size_t pieceCount)
+{
+	/*
+	 * Returns piece boundaries: first is 0, last is sources size.
+	 * Each inner boundary is the first whitespace at or after
+	 *  its equal share offset, so pieces may be empty.
+	 */
+	std::vector<size_t> bounds{ 0 };
+	for (size_t i = 1; i < pieceCount; ++i)
+	{
+		size_t bound = std::max(bounds.back(), sources.size() / pieceCount * i);
+		while (bound < sources.size() && !HasCharClass(sources[bound], CC_SPACE))
+		{
+			++bound;
+		}
+		bounds.push_back(bound);
+	}
+	bounds.push_back(sources.size());
+	return bounds;
+}
+}
+
+void ReadAllParallel(std::string_view sources, TokenStream& stream, ThreadPool& pool)
+{
+	if (sources.size() > UINT32_MAX)
+	{
+		throw std::length_error("sources are too large for TokenStream");
+	}
+	const size_t threadCount = pool.GetThreadCount();
+	if (threadCount < 2)
+	{
+		CalcLexer{ sources }.ReadAll(stream);
+		return;
+	}
+
+	const std::vector<size_t> bounds = SplitAtSpaces(sources, threadCount);
+	std::vector<TokenStream> pieces(threadCount);
+	auto readPiece = [&](size_t index) {
+		CalcLexer{ sources.substr(bounds[index], bounds[index + 1] - bounds[index]) }.ReadAll(pieces[index]);
+	};
+
+	pool.Run(readPiece);
+
+	size_t total = 0;
+	for (const TokenStream& piece : pieces)
+	{
+		total += piece.Size();
+	}
+	stream.Clear();
+	stream.Reserve(total);
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		stream.Append(pieces[i], static_cast<uint32_t>(bounds[i]));
+	}
+}
+
+}
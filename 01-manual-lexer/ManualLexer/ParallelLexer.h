@@ -0,0 +1,21 @@
+#pragma once
+
+#include <calc-common/TokenStream.h>
+#include <string_view>
+#include "ThreadPool.h"
+
+namespace calc::manual
+{
+
+/*
+ * Lexes large sources on several threads.
+ * Calc grammar has no tokens containing whitespace, so sources are split
+ *  at whitespace near equal offsets and pieces are lexed independently.
+ * Sources are split into one piece per `pool` thread.
+ * Tokens are stored into `stream` in source order with global offsets.
+ * Throws std::length_error if sources don't fit 32-bit offsets,
+ *  exceptions thrown while lexing a piece are rethrown on the calling thread.
+ */
+void ReadAllParallel(std::string_view sources, TokenStream& stream, ThreadPool& pool);
+
+}
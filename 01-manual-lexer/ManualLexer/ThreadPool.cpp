@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace calc::manual
+{
+
+ThreadPool::ThreadPool(size_t threadCount)
+	: m_errors(std::max<size_t>(threadCount, 1))
+{
+	m_workers.reserve(m_errors.size() - 1);
+	for (size_t i = 1; i < m_errors.size(); ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::RunWorker, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskReady.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return m_errors.size();
+}
+
+void ThreadPool::Run(const std::function<void(size_t)>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		std::fill(m_errors.begin(), m_errors.end(), nullptr);
+		m_pendingCount = m_workers.size();
+		++m_generation;
+	}
+	m_taskReady.notify_all();
+
+	try
+	{
+		task(0);
+	}
+	catch (...)
+	{
+		m_errors[0] = std::current_exception();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_taskDone.wait(lock, [this] {
+			return m_pendingCount == 0;
+		});
+		m_task = nullptr;
+	}
+
+	for (const std::exception_ptr& error : m_errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+void ThreadPool::RunWorker(size_t index)
+{
+	size_t seenGeneration = 0;
+	for (;;)
+	{
+		const std::function<void(size_t)>* task = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskReady.wait(lock, [&] {
+				return m_stopping || m_generation != seenGeneration;
+			});
+			if (m_stopping)
+			{
+				return;
+			}
+			seenGeneration = m_generation;
+			task = m_task;
+		}
+
+		/*
+		 * Exception must not leave the thread function, otherwise
+		 *  std::terminate is called, so it is handed over to Run.
+		 */
+		std::exception_ptr error;
+		try
+		{
+			(*task)(index);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_errors[index] = error;
+			--m_pendingCount;
+		}
+		m_taskDone.notify_one();
+	}
+}
+
+}
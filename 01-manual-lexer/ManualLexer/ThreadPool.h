@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace calc::manual
+{
+
+/*
+ * Fixed set of worker threads which are started once and reused,
+ *  so repeated parallel runs don't pay for thread creation.
+ * Run must not be called concurrently on the same pool.
+ */
+class ThreadPool
+{
+public:
+	// Starts threadCount - 1 workers, the calling thread of Run is the last one.
+	explicit ThreadPool(size_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t GetThreadCount() const;
+
+	// Calls task(index) once for each index in [0, GetThreadCount()) on different threads
+	//  and waits for all calls. Rethrows the exception of the lowest failed index.
+	void Run(const std::function<void(size_t)>& task);
+
+private:
+	void RunWorker(size_t index);
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_taskReady;
+	std::condition_variable m_taskDone;
+	const std::function<void(size_t)>* m_task = nullptr;
+	std::vector<std::exception_ptr> m_errors;
+	size_t m_generation = 0;
+	size_t m_pendingCount = 0;
+	bool m_stopping = false;
+};
+
+}
@@ -0,0 +1,33 @@
+#define CALC_BENCH_IMPLEMENT // This adds allocation counter - only do this in one cpp file
+#include <calc-bench/CalcBench.h>
+#include "../ManualLexer/CalcLexer.h"
+#include "../ManualLexer/ParallelLexer.h"
+#include <thread>
+
+using namespace calc;
+using namespace calc::manual;
+
+int main(int argc, char* argv[])
+{
+	TokenStream stream;
+	ThreadPool pool{ std::thread::hardware_concurrency() };
+	return calc_bench::RunBenchmarks(argc, argv, {
+		{ "ManualLexer/Read", [](const std::string& text) {
+			CalcLexer lexer{ text };
+			size_t count = 0;
+			for (Token token = lexer.Read(); token.type != TT_END; token = lexer.Read())
+			{
+				++count;
+			}
+			return count;
+		} },
+		{ "ManualLexer/TokenStream", [&](const std::string& text) {
+			CalcLexer{ text }.ReadAll(stream);
+			return stream.Size();
+		} },
+		{ "ManualLexer/Parallel", [&](const std::string& text) {
+			ReadAllParallel(text, stream, pool);
+			return stream.Size();
+		} },
+	});
+}
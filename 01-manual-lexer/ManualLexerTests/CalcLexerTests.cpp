@@ -1,9 +1,15 @@
 #include <catch2/catch.hpp>
+#include <calc-common/KeywordTable.h>
+#include <calc-common/LineIndex.h>
 #include "../ManualLexer/CalcLexer.h"
+#include "../ManualLexer/CalcStreamLexer.h"
+#include "../ManualLexer/ParallelLexer.h"
+#include <thread>
 #include <vector>
 
 using namespace std;
 using namespace calc;
+using namespace calc::manual;
 
 namespace calc
 {
@@ -12,6 +18,11 @@ bool operator ==(const Token& a, const Token& b)
 	return a.type == b.type && a.value == b.value;
 }
 
+bool operator ==(const OwnedToken& a, const OwnedToken& b)
+{
+	return a.type == b.type && a.value == b.value && a.offset == b.offset;
+}
+
 string_view GetTokenName(TokenType type)
 {
 	switch (type)
@@ -52,6 +63,17 @@ std::ostream& operator<<(std::ostream& stream, const Token& token)
 	stream << ")";
 	return stream;
 }
+
+std::ostream& operator<<(std::ostream& stream, const OwnedToken& token)
+{
+	stream << "Token(" << GetTokenName(token.type);
+	if (token.value)
+	{
+		stream << ", " << *token.value;
+	}
+	stream << ")";
+	return stream;
+}
 }
 
 namespace
@@ -70,17 +92,52 @@ TokenList Tokenize(string_view text)
 	return results;
 }
 
+using OwnedTokenList = vector<OwnedToken>;
+
+OwnedTokenList TokenizeOwned(string_view text)
+{
+	OwnedTokenList results;
+	for (const Token& token : Tokenize(text))
+	{
+		results.emplace_back(token);
+	}
+	return results;
+}
+
+OwnedTokenList TokenizeByChunks(string_view text, size_t chunkSize)
+{
+	OwnedTokenList results;
+	CalcStreamLexer lexer;
+	TokenList tokens;
+	auto moveTokens = [&] {
+		// Token values are valid only until the next call to the lexer.
+		for (const Token& token : tokens)
+		{
+			results.emplace_back(token);
+		}
+		tokens.clear();
+	};
+	for (size_t start = 0; start < text.size(); start += chunkSize)
+	{
+		lexer.Feed(text.substr(start, chunkSize), tokens);
+		moveTokens();
+	}
+	lexer.Finish(tokens);
+	moveTokens();
+	return results;
+}
+
 }
 
 TEST_CASE("Can read one number", "[CalcLexer]") {
 	REQUIRE(Tokenize("0"sv) == TokenList{
-		Token{ TT_NUMBER, "0"s },
+		Token{ TT_NUMBER, "0"sv },
 		});
 	REQUIRE(Tokenize("1"sv) == TokenList{
-		Token{ TT_NUMBER, "1"s },
+		Token{ TT_NUMBER, "1"sv },
 		});
 	REQUIRE(Tokenize("9876543210"sv) == TokenList{
-		Token{ TT_NUMBER, "9876543210"s },
+		Token{ TT_NUMBER, "9876543210"sv },
 		});
 }
 
@@ -110,25 +167,40 @@ TEST_CASE("Can read one bracket", "[CalcLexer]") {
 
 TEST_CASE("Can read one id", "[CalcLexer]") {
 	REQUIRE(Tokenize("a"sv) == TokenList{
-		Token{ TT_ID, "a"s },
+		Token{ TT_ID, "a"sv },
 		});
 	REQUIRE(Tokenize("A"sv) == TokenList{
-		Token{ TT_ID, "A"s },
+		Token{ TT_ID, "A"sv },
 		});
 	REQUIRE(Tokenize("_"sv) == TokenList{
-		Token{ TT_ID, "_"s },
+		Token{ TT_ID, "_"sv },
 		});
 	REQUIRE(Tokenize("a12"sv) == TokenList{
-		Token{ TT_ID, "a12"s },
+		Token{ TT_ID, "a12"sv },
 		});
 	REQUIRE(Tokenize("A_1_b"sv) == TokenList{
-		Token{ TT_ID, "A_1_b"s },
+		Token{ TT_ID, "A_1_b"sv },
 		});
 	REQUIRE(Tokenize("_1B"sv) == TokenList{
-		Token{ TT_ID, "_1B"s },
+		Token{ TT_ID, "_1B"sv },
 		});
 	REQUIRE(Tokenize("1B_"sv) == TokenList{
-		Token{ TT_ERROR, "1B_"s },
+		Token{ TT_ERROR, "1B_"sv },
+		});
+}
+
+TEST_CASE("Can read ids with last letters of alphabet", "[CalcLexer]") {
+	REQUIRE(Tokenize("z"sv) == TokenList{
+		Token{ TT_ID, "z"sv },
+		});
+	REQUIRE(Tokenize("Z"sv) == TokenList{
+		Token{ TT_ID, "Z"sv },
+		});
+	REQUIRE(Tokenize("xyz_XYZ"sv) == TokenList{
+		Token{ TT_ID, "xyz_XYZ"sv },
+		});
+	REQUIRE(Tokenize("1z"sv) == TokenList{
+		Token{ TT_ERROR, "1z"sv },
 		});
 }
 
@@ -140,11 +212,11 @@ TEST_CASE("Can read one equal", "[CalcLexer]") {
 
 TEST_CASE("Can read expression tokens", "[CalcLexer]") {
 	REQUIRE(Tokenize("45+9+28"sv) == TokenList{
-		Token{ TT_NUMBER, "45"s },
+		Token{ TT_NUMBER, "45"sv },
 		Token{ TT_PLUS },
-		Token{ TT_NUMBER, "9"s },
+		Token{ TT_NUMBER, "9"sv },
 		Token{ TT_PLUS },
-		Token{ TT_NUMBER, "28"s },
+		Token{ TT_NUMBER, "28"sv },
 		});
 #if 1 // fractional number support
 	REQUIRE(Tokenize("5+7.005"sv) == TokenList{
@@ -293,31 +365,31 @@ TEST_CASE("Can read expression tokens with whitespaces") {
 
 TEST_CASE("Cannot read number which starts with zero") {
 	REQUIRE(Tokenize("0123456789"sv) == TokenList{
-		Token{ TT_ERROR, "0123456789"s },
+		Token{ TT_ERROR, "0123456789"sv },
 		});
 	REQUIRE(Tokenize("01.25"sv) == TokenList{
-		Token{ TT_ERROR, "01.25"s },
+		Token{ TT_ERROR, "01.25"sv },
 		});
 	REQUIRE(Tokenize("+01"sv) == TokenList{
 		Token{ TT_PLUS },
-		Token{ TT_ERROR, "01"s },
+		Token{ TT_ERROR, "01"sv },
 		});
 	REQUIRE(Tokenize("+00.32"sv) == TokenList{
 		Token{ TT_PLUS },
-		Token{ TT_ERROR, "00.32"s },
+		Token{ TT_ERROR, "00.32"sv },
 		});
 	REQUIRE(Tokenize("4+0521"sv) == TokenList{
 		Token{ TT_NUMBER, "4" },
 		Token{ TT_PLUS },
-		Token{ TT_ERROR, "0521"s },
+		Token{ TT_ERROR, "0521"sv },
 		});
 	REQUIRE(Tokenize("02+21"sv) == TokenList{
-		Token{ TT_ERROR, "02"s },
+		Token{ TT_ERROR, "02"sv },
 		Token{ TT_PLUS },
 		Token{ TT_NUMBER, "21" },
 		});
 	REQUIRE(Tokenize("02.4+5.3"sv) == TokenList{
-		Token{ TT_ERROR, "02.4"s },
+		Token{ TT_ERROR, "02.4"sv },
 		Token{ TT_PLUS },
 		Token{ TT_NUMBER, "5.3" },
 		});
@@ -325,34 +397,449 @@ TEST_CASE("Cannot read number which starts with zero") {
 
 TEST_CASE("Can read statment with whitespaces", "[CalcLexer]") {
 	REQUIRE(Tokenize("a = 1"sv) == TokenList{
-		Token{ TT_ID, "a"s},
+		Token{ TT_ID, "a"sv},
 		Token{ TT_EQUAL },
-		Token{ TT_NUMBER, "1"s}
+		Token{ TT_NUMBER, "1"sv}
 		});
 	REQUIRE(Tokenize(" var=7* (1 + 6)"sv) == TokenList{
-		Token{ TT_ID, "var"s},
+		Token{ TT_ID, "var"sv},
 		Token{ TT_EQUAL },
-		Token{ TT_NUMBER, "7"s},
+		Token{ TT_NUMBER, "7"sv},
 		Token{ TT_ASTERISK },
 		Token{ TT_OPEN_BRACKET },
-		Token{ TT_NUMBER, "1"s},
+		Token{ TT_NUMBER, "1"sv},
 		Token{ TT_PLUS },
-		Token{ TT_NUMBER, "6"s },
+		Token{ TT_NUMBER, "6"sv },
 		Token{ TT_CLOSE_BRACKET },
 		});	
 	REQUIRE(Tokenize("  k = 4 / (8.ab + .1) - 5abc * 9 "sv) == TokenList{
-		Token{ TT_ID, "k"s},
+		Token{ TT_ID, "k"sv},
 		Token{ TT_EQUAL },
-		Token{ TT_NUMBER, "4"s},
+		Token{ TT_NUMBER, "4"sv},
 		Token{ TT_SLASH },
 		Token{ TT_OPEN_BRACKET },
-		Token{ TT_ERROR, "8.ab"s},
+		Token{ TT_ERROR, "8.ab"sv},
 		Token{ TT_PLUS },
-		Token{ TT_ERROR, ".1"s },
+		Token{ TT_ERROR, ".1"sv },
 		Token{ TT_CLOSE_BRACKET },
 		Token{ TT_MINUS },
-		Token{ TT_ERROR, "5abc"s},
+		Token{ TT_ERROR, "5abc"sv},
 		Token{ TT_ASTERISK },
-		Token{ TT_NUMBER, "9"s},
+		Token{ TT_NUMBER, "9"sv},
 		});
 }
+
+TEST_CASE("Token values point into lexer sources", "[CalcLexer]") {
+	const string_view text = "x1 + 42"sv;
+	CalcLexer lexer{ text };
+	const Token id = lexer.Read();
+	REQUIRE(id.value->data() == text.data());
+	lexer.Read();
+	const Token number = lexer.Read();
+	REQUIRE(number.value->data() == text.data() + 5);
+}
+
+TEST_CASE("Owned token keeps value after sources are gone", "[CalcLexer]") {
+	OwnedToken owned;
+	{
+		string text = "abc";
+		owned = OwnedToken(CalcLexer{ text }.Read());
+	}
+	REQUIRE(owned.type == TT_ID);
+	REQUIRE(owned.value == "abc"s);
+	REQUIRE(OwnedToken(Token{ TT_PLUS }).value == nullopt);
+}
+
+TEST_CASE("Can read tokens in batches", "[CalcLexer]") {
+	CalcLexer lexer{ "a = 1 + b"sv };
+	Token buffer[2];
+	REQUIRE(lexer.ReadBatch(buffer, 2) == 2);
+	REQUIRE(buffer[0] == Token{ TT_ID, "a"sv });
+	REQUIRE(buffer[1] == Token{ TT_EQUAL });
+	REQUIRE(lexer.ReadBatch(buffer, 2) == 2);
+	REQUIRE(buffer[0] == Token{ TT_NUMBER, "1"sv });
+	REQUIRE(buffer[1] == Token{ TT_PLUS });
+	REQUIRE(lexer.ReadBatch(buffer, 2) == 1);
+	REQUIRE(buffer[0] == Token{ TT_ID, "b"sv });
+	REQUIRE(lexer.ReadBatch(buffer, 2) == 0);
+}
+
+TEST_CASE("Can read all tokens into reused buffer", "[CalcLexer]") {
+	TokenList tokens;
+	CalcLexer{ "(x - 2) * 3.5"sv }.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{
+		Token{ TT_OPEN_BRACKET },
+		Token{ TT_ID, "x"sv },
+		Token{ TT_MINUS },
+		Token{ TT_NUMBER, "2"sv },
+		Token{ TT_CLOSE_BRACKET },
+		Token{ TT_ASTERISK },
+		Token{ TT_NUMBER, "3.5"sv },
+		});
+	const size_t capacity = tokens.capacity();
+	CalcLexer{ "y / 7"sv }.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{
+		Token{ TT_ID, "y"sv },
+		Token{ TT_SLASH },
+		Token{ TT_NUMBER, "7"sv },
+		});
+	REQUIRE(tokens.capacity() == capacity);
+}
+
+TEST_CASE("Can read tokens into compact stream", "[CalcLexer]") {
+	const string_view text = " ab = 1.5 *\t(c)"sv;
+	TokenStream stream;
+	CalcLexer{ text }.ReadAll(stream);
+	REQUIRE(stream.GetTypes() == vector<uint8_t>{
+		TT_ID, TT_EQUAL, TT_NUMBER, TT_ASTERISK, TT_OPEN_BRACKET, TT_ID, TT_CLOSE_BRACKET,
+		});
+	REQUIRE(stream.GetOffsets() == vector<uint32_t>{ 1, 4, 6, 10, 12, 13, 14 });
+	REQUIRE(stream.GetLengths() == vector<uint32_t>{ 2, 1, 3, 1, 1, 1, 1 });
+	REQUIRE(stream.GetToken(0, text) == Token{ TT_ID, "ab"sv });
+	REQUIRE(stream.GetToken(2, text) == Token{ TT_NUMBER, "1.5"sv });
+	REQUIRE(stream.GetToken(3, text) == Token{ TT_ASTERISK });
+}
+
+TEST_CASE("Can read long runs of whitespaces and id characters", "[CalcLexer]") {
+	const string spaces(100, ' ');
+	const string id = "a" + string(70, 'z') + "_9";
+	const string number = "1" + string(40, '0') + "." + string(33, '5');
+	const string text = spaces + id + "\t\n" + spaces + number + spaces + "+";
+	REQUIRE(Tokenize(text) == TokenList{
+		Token{ TT_ID, id },
+		Token{ TT_NUMBER, number },
+		Token{ TT_PLUS },
+		});
+	REQUIRE(Tokenize(spaces + "1" + string(40, '2') + "a" + spaces) == TokenList{
+		Token{ TT_ERROR, "1" + string(40, '2') + "a" },
+		});
+}
+
+TEST_CASE("All supported scan kernels agree with scalar one", "[CalcLexer]") {
+	const string text = "  \t\n  abc_XYZ_019.az  \xC0\xFF 9_.Z+__" + string(40, ' ') + string(45, 'q') + "# .";
+	const CharScanners& scalar = GetCharScanners(ScanKernel::Scalar);
+	for (ScanKernel kernel : { ScanKernel::Sse2, ScanKernel::Avx2 })
+	{
+		if (!IsScanKernelSupported(kernel))
+		{
+			continue;
+		}
+		const CharScanners& scanners = GetCharScanners(kernel);
+		for (size_t position = 0; position <= text.size(); ++position)
+		{
+			REQUIRE(scanners.skipSpaces(text.data(), text.size(), position) == scalar.skipSpaces(text.data(), text.size(), position));
+			REQUIRE(scanners.skipIdChars(text.data(), text.size(), position) == scalar.skipIdChars(text.data(), text.size(), position));
+			REQUIRE(scanners.skipNumberChars(text.data(), text.size(), position) == scalar.skipNumberChars(text.data(), text.size(), position));
+		}
+	}
+}
+
+TEST_CASE("Stream lexer keeps tokens split between chunks", "[CalcStreamLexer]") {
+	REQUIRE(TokenizeByChunks("12.5"sv, 2) == OwnedTokenList{
+		OwnedToken(Token{ TT_NUMBER, "12.5"sv }),
+		});
+	REQUIRE(TokenizeByChunks("0 + 05"sv, 5) == OwnedTokenList{
+		OwnedToken(Token{ TT_NUMBER, "0"sv, 0 }),
+		OwnedToken(Token{ TT_PLUS, nullopt, 2 }),
+		OwnedToken(Token{ TT_ERROR, "05"sv, 4 }),
+		});
+	REQUIRE(TokenizeByChunks("abc"sv, 1) == OwnedTokenList{
+		OwnedToken(Token{ TT_ID, "abc"sv }),
+		});
+}
+
+TEST_CASE("Stream lexer gives same tokens for any chunk size", "[CalcStreamLexer]") {
+	const string_view texts[] = {
+		"  k = 4 / (8.ab + .1) - 5abc * 9 "sv,
+		" var=7* (1 + 6)"sv,
+		"1.005+43.54+1 \n 5.00.0 0123 a.b"sv,
+	};
+	for (string_view text : texts)
+	{
+		const OwnedTokenList expected = TokenizeOwned(text);
+		for (size_t chunkSize = 1; chunkSize <= text.size(); ++chunkSize)
+		{
+			REQUIRE(TokenizeByChunks(text, chunkSize) == expected);
+		}
+	}
+}
+
+TEST_CASE("Tokens have offsets in sources", "[CalcLexer]") {
+	const TokenList tokens = Tokenize("  ab = 1.5 *\t(c)"sv);
+	vector<size_t> offsets;
+	for (const Token& token : tokens)
+	{
+		offsets.push_back(token.offset);
+	}
+	REQUIRE(offsets == vector<size_t>{ 2, 5, 7, 11, 13, 14, 15 });
+}
+
+TEST_CASE("Line index converts offsets to lines and columns", "[LineIndex]") {
+	const string_view text = "a = 1\n\nb = a +\n  2.5"sv;
+	const LineIndex index{ text };
+	const auto checkLocation = [&](size_t offset, size_t line, size_t column) {
+		const SourceLocation location = index.GetLocation(offset);
+		REQUIRE(location.line == line);
+		REQUIRE(location.column == column);
+	};
+	checkLocation(0, 1, 1);
+	checkLocation(4, 1, 5);
+	checkLocation(5, 1, 6);
+	checkLocation(6, 2, 1);
+	checkLocation(7, 3, 1);
+	checkLocation(13, 3, 7);
+	checkLocation(17, 4, 3);
+	checkLocation(text.size(), 4, 6);
+}
+
+TEST_CASE("Line index can be shared by concurrent readers", "[LineIndex]") {
+	string text;
+	for (int i = 0; i < 1000; ++i)
+	{
+		text += "a + 1\n";
+	}
+	const LineIndex index{ text };
+	vector<SourceLocation> locations(8);
+	vector<std::thread> threads;
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		threads.emplace_back([&, i] {
+			locations[i] = index.GetLocation(6 * 500 + 4);
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	for (const SourceLocation& location : locations)
+	{
+		REQUIRE(location.line == 501);
+		REQUIRE(location.column == 5);
+	}
+}
+
+TEST_CASE("Error-recovering lexer collects error spans and continues", "[CalcLexer]") {
+	vector<LexError> errors;
+	CalcLexer lexer{ "05 + .5 - 1..2 * 1.2.3 / 5. = 0x1 # (8.ab) 1.5"sv, errors };
+	TokenList tokens;
+	lexer.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{
+		Token{ TT_PLUS },
+		Token{ TT_MINUS },
+		Token{ TT_ASTERISK },
+		Token{ TT_SLASH },
+		Token{ TT_EQUAL },
+		Token{ TT_OPEN_BRACKET },
+		Token{ TT_CLOSE_BRACKET },
+		Token{ TT_NUMBER, "1.5"sv },
+		});
+	const vector<pair<size_t, uint32_t>> expectedSpans = {
+		{ 0, 2 }, { 5, 2 }, { 10, 4 }, { 17, 5 }, { 25, 2 }, { 30, 3 }, { 34, 1 }, { 37, 4 },
+	};
+	const vector<LexErrorKind> expectedKinds = {
+		LexErrorKind::LeadingZero,
+		LexErrorKind::LeadingDot,
+		LexErrorKind::DoubleDot,
+		LexErrorKind::DoubleDot,
+		LexErrorKind::TrailingDot,
+		LexErrorKind::LetterInNumber,
+		LexErrorKind::UnexpectedChar,
+		LexErrorKind::LetterInNumber,
+	};
+	REQUIRE(errors.size() == expectedKinds.size());
+	for (size_t i = 0; i < errors.size(); ++i)
+	{
+		REQUIRE(errors[i].offset == expectedSpans[i].first);
+		REQUIRE(errors[i].length == expectedSpans[i].second);
+		REQUIRE(errors[i].kind == expectedKinds[i]);
+	}
+}
+
+TEST_CASE("Error span longer than 64K is split into adjacent errors", "[CalcLexer]") {
+	const string text = "x 5" + string(UINT16_MAX + 10, 'a') + " y";
+	vector<LexError> errors;
+	CalcLexer lexer{ text, errors };
+	TokenList tokens;
+	lexer.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{ Token{ TT_ID, "x"sv }, Token{ TT_ID, "y"sv } });
+	REQUIRE(errors.size() == 2);
+	REQUIRE(errors[0].offset == 2);
+	REQUIRE(errors[0].length == UINT16_MAX);
+	REQUIRE(errors[1].offset == 2 + UINT16_MAX);
+	REQUIRE(errors[1].length == 11);
+	REQUIRE(errors[0].kind == LexErrorKind::LetterInNumber);
+	REQUIRE(errors[1].kind == LexErrorKind::LetterInNumber);
+}
+
+// Inputs where AutoLexerFuzzer once found different tokens from two lexers.
+TEST_CASE("Grammar matches AutoLexer on carriage return and dot after id", "[CalcLexer]") {
+	REQUIRE(Tokenize("\r+"sv) == TokenList{
+		Token{ TT_PLUS },
+		});
+	REQUIRE(Tokenize("0\rB"sv) == TokenList{
+		Token{ TT_NUMBER, "0"sv },
+		Token{ TT_ID, "B"sv },
+		});
+	REQUIRE(Tokenize("\rC+"sv) == TokenList{
+		Token{ TT_ID, "C"sv },
+		Token{ TT_PLUS },
+		});
+	REQUIRE(Tokenize("9\r."sv) == TokenList{
+		Token{ TT_NUMBER, "9"sv },
+		Token{ TT_ERROR, "."sv },
+		});
+	REQUIRE(Tokenize("X."sv) == TokenList{
+		Token{ TT_ERROR, "X."sv },
+		});
+	REQUIRE(Tokenize("a.b_1.2+x"sv) == TokenList{
+		Token{ TT_ERROR, "a.b_1.2"sv },
+		Token{ TT_PLUS },
+		Token{ TT_ID, "x"sv },
+		});
+
+	vector<LexError> errors;
+	CalcLexer lexer{ "x.y = 1"sv, errors };
+	TokenList tokens;
+	lexer.ReadAll(tokens);
+	REQUIRE(errors.size() == 1);
+	REQUIRE(errors[0].length == 3);
+	REQUIRE(errors[0].kind == LexErrorKind::DotInId);
+}
+
+TEST_CASE("Parallel lexing gives same tokens as sequential one", "[ParallelLexer]") {
+	string text;
+	for (int i = 0; i < 300; ++i)
+	{
+		text += "var" + to_string(i) + " = (" + to_string(i * 7) + ".25 +\t05 - x_" + to_string(i) + ") * 1..2\n";
+	}
+	TokenStream expected;
+	CalcLexer{ text }.ReadAll(expected);
+	for (size_t threadCount : { 1, 2, 3, 8, 64 })
+	{
+		ThreadPool pool{ threadCount };
+		TokenStream stream;
+		ReadAllParallel(text, stream, pool);
+		// Pool threads are reused by the next call.
+		ReadAllParallel(text, stream, pool);
+		REQUIRE(stream.GetTypes() == expected.GetTypes());
+		REQUIRE(stream.GetOffsets() == expected.GetOffsets());
+		REQUIRE(stream.GetLengths() == expected.GetLengths());
+	}
+	ThreadPool pool{ 4 };
+	TokenStream stream;
+	ReadAllParallel("a+b"sv, stream, pool);
+	REQUIRE(stream.GetTypes() == vector<uint8_t>{ TT_ID, TT_PLUS, TT_ID });
+}
+
+TEST_CASE("Thread pool rethrows worker exceptions on calling thread", "[ThreadPool]") {
+	ThreadPool pool{ 4 };
+	REQUIRE(pool.GetThreadCount() == 4);
+	REQUIRE_THROWS_WITH(pool.Run([](size_t index) {
+		if (index == 2)
+		{
+			throw std::runtime_error("piece 2 failed");
+		}
+	}), "piece 2 failed");
+
+	vector<size_t> calls(pool.GetThreadCount());
+	pool.Run([&](size_t index) {
+		++calls[index];
+	});
+	REQUIRE(calls == vector<size_t>{ 1, 1, 1, 1 });
+}
+
+TEST_CASE("Lexer reclassifies ids found in keyword table", "[KeywordTable]") {
+	const auto TT_MIN = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const auto TT_MAX = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 1);
+	const auto TT_PI = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 2);
+	const KeywordTable keywords{ { { "min", TT_MIN }, { "max", TT_MAX }, { "pi", TT_PI } } };
+	REQUIRE(keywords.Size() == 3);
+
+	CalcLexer lexer{ "max(min, pi) + minute * p" };
+	lexer.SetKeywords(keywords);
+	TokenList tokens;
+	lexer.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{
+		Token{ TT_MAX, "max"sv },
+		Token{ TT_OPEN_BRACKET },
+		Token{ TT_MIN, "min"sv },
+		Token{ TT_ERROR },
+		Token{ TT_PI, "pi"sv },
+		Token{ TT_CLOSE_BRACKET },
+		Token{ TT_PLUS },
+		Token{ TT_ID, "minute"sv },
+		Token{ TT_ASTERISK },
+		Token{ TT_ID, "p"sv },
+	});
+}
+
+TEST_CASE("Keyword tokens keep their value in token stream", "[KeywordTable]") {
+	const auto TT_MAX = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const KeywordTable keywords{ { { "max", TT_MAX } } };
+	const string_view text = "max(a)"sv;
+	CalcLexer lexer{ text };
+	lexer.SetKeywords(keywords);
+	TokenStream stream;
+	lexer.ReadAll(stream);
+	REQUIRE(stream.Size() == 4);
+	REQUIRE(stream.GetType(0) == TT_MAX);
+	REQUIRE(stream.GetToken(0, text) == Token{ TT_MAX, "max"sv });
+	REQUIRE(stream.GetToken(2, text) == Token{ TT_ID, "a"sv });
+}
+
+TEST_CASE("Keyword table finds every keyword of large set", "[KeywordTable]") {
+	vector<Keyword> keywords;
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		keywords.push_back(Keyword{ "kw" + to_string(i), static_cast<TokenType>(FIRST_CUSTOM_TOKEN + i % 100) });
+	}
+	const KeywordTable table{ keywords };
+	REQUIRE(table.Size() == keywords.size());
+	for (const Keyword& keyword : keywords)
+	{
+		REQUIRE(table.Find(keyword.text) == keyword.type);
+	}
+	REQUIRE(table.Find("kw") == TT_ID);
+	REQUIRE(table.Find("kw5000") == TT_ID);
+	REQUIRE(table.Find("kw00") == TT_ID);
+	REQUIRE(table.Find("") == TT_ID);
+	REQUIRE(KeywordTable{}.Find("kw1") == TT_ID);
+}
+
+TEST_CASE("Keyword table rejects invalid keywords", "[KeywordTable]") {
+	const auto TT_MIN = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min", TT_MIN }, { "min", TT_MIN } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "", TT_MIN } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min", TT_ID } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "2pi", TT_MIN } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "a.b", TT_MIN } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min-max", TT_MIN } }), invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min ", TT_MIN } }), invalid_argument);
+	REQUIRE(KeywordTable({ { "_min2", TT_MIN } }).Find("_min2") == TT_MIN);
+}
+
+TEST_CASE("Lexer can be reset to new sources", "[CalcLexer]") {
+	const auto TT_PI = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const KeywordTable keywords{ { { "pi", TT_PI } } };
+	vector<LexError> errors;
+	CalcLexer lexer{ "a + 01", errors };
+	lexer.SetKeywords(keywords);
+	REQUIRE(lexer.Read() == Token{ TT_ID, "a"sv });
+
+	lexer.Reset("pi * 2");
+	TokenList tokens;
+	lexer.ReadAll(tokens);
+	REQUIRE(tokens == TokenList{
+		Token{ TT_PI, "pi"sv },
+		Token{ TT_ASTERISK },
+		Token{ TT_NUMBER, "2"sv },
+	});
+	REQUIRE(tokens[2].offset == 5);
+
+	lexer.Reset("01");
+	REQUIRE(lexer.Read() == Token{ TT_END });
+	REQUIRE(errors.size() == 1);
+
+	lexer.Reset("");
+	REQUIRE(lexer.Read() == Token{ TT_END });
+}
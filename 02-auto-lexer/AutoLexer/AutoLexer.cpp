@@ -1,44 +1,130 @@
 #include "CalcLexer.h"
+#include <cstdint>
+#include <stdexcept>
 
 using namespace calc;
 
-CalcLexer::CalcLexer(const boost::string_view sources)
+CalcLexer::CalcLexer(const std::string_view sources)
+	: CalcLexer(sources, GetCalcStateMachine())
 {
-	lexertl::rules rules;
-	m_autoLexer = std::make_unique<lexertl::state_machine>();
+}
 
-	rules.push("[a-zA-Z_][a-zA-Z0-9_]*", calc::TT_ID);
-	rules.push("(0|[1-9][0-9]*)(\\.[0-9]+)?", calc::TT_NUMBER);
-	rules.push("[a-zA-Z0-9_\\.]+", calc::TT_ERROR);
-	rules.push("\\+", calc::TT_PLUS);
-	rules.push("\\-", calc::TT_MINUS);
-	rules.push("\\*", calc::TT_ASTERISK);
-	rules.push("\\/", calc::TT_SLASH);
-	rules.push("\\=", calc::TT_EQUAL);
-	rules.push("\\(", calc::TT_OPEN_BRACKET);
-	rules.push("\\)", calc::TT_CLOSE_BRACKET);
+CalcLexer::CalcLexer(const std::string_view sources, DfaMode mode)
+	: CalcLexer(sources, GetCalcStateMachine(mode))
+{
+}
 
-	rules.push("[ \t\r\n]+", rules.skip());
+CalcLexer::CalcLexer(const std::string_view sources, StateMachinePtr stateMachine)
+	: m_autoLexer(std::move(stateMachine))
+{
+	m_begin = sources.data();
+	m_end = sources.data() + sources.size();
+	m_stateIter = lexertl::citerator(m_begin, m_end, *m_autoLexer);
+}
 
-	lexertl::generator::build(rules, *m_autoLexer);
+CalcLexer::CalcLexer(const std::string_view sources, const CalcRuleSet& ruleSet)
+	: m_ruleSet(&ruleSet)
+	, m_ruleSetVersion(ruleSet.GetVersion())
+{
+	m_autoLexer = ruleSet.GetStateMachine();
+	m_begin = sources.data();
+	m_end = sources.data() + sources.size();
+	m_stateIter = lexertl::citerator(m_begin, m_end, *m_autoLexer);
+}
 
-	//m_autoLexer->minimise();
+const lexertl::state_machine& CalcLexer::GetStateMachine() const
+{
+	return *m_autoLexer;
+}
 
-	m_stateIter = lexertl::citerator(sources.begin(), sources.end(), *m_autoLexer);
+void CalcLexer::Reset(std::string_view sources)
+{
+	if (m_ruleSet)
+	{
+		m_ruleSetVersion = m_ruleSet->GetVersion();
+		m_autoLexer = m_ruleSet->GetStateMachine();
+	}
+	m_begin = sources.data();
+	m_end = sources.data() + sources.size();
+	m_stateIter = lexertl::citerator(m_begin, m_end, *m_autoLexer);
+}
 
+void CalcLexer::SetKeywords(const KeywordTable& keywords)
+{
+	m_keywords = &keywords;
 }
 
 Token CalcLexer::Read()
 {
+	if (m_ruleSet)
+	{
+		SyncRuleSet();
+	}
 	lexertl::citerator end;
 	if (m_stateIter != end)
 	{
-		Token result(m_stateIter->id, m_stateIter->str());
+		const Token result = MakeToken(GetTokenId(), GetTokenText(),
+			static_cast<size_t>(m_stateIter->first - m_begin));
 		++m_stateIter;
 		return result;
 	}
 	else
 	{
-		return { TT_END };
+		return Token{ TT_END, std::nullopt, static_cast<size_t>(m_end - m_begin) };
+	}
+}
+
+void CalcLexer::ReadAll(TokenStream& stream)
+{
+	if (m_ruleSet)
+	{
+		SyncRuleSet();
 	}
-}
\ No newline at end of file
+	lexertl::citerator end;
+	if (m_stateIter != end && m_stateIter->eoi - m_begin > UINT32_MAX)
+	{
+		throw std::length_error("sources are too large for TokenStream");
+	}
+	stream.Clear();
+	for (; m_stateIter != end; ++m_stateIter)
+	{
+		stream.Push(ToTokenType(GetTokenId()),
+			static_cast<uint32_t>(m_stateIter->first - m_begin),
+			static_cast<uint32_t>(m_stateIter->second - m_stateIter->first));
+	}
+}
+
+void CalcLexer::SyncRuleSet()
+{
+	const size_t version = m_ruleSet->GetVersion();
+	if (version == m_ruleSetVersion)
+	{
+		return;
+	}
+
+	/*
+	 * Iterator has already matched next token with old DFA,
+	 *  so matching restarts from its beginning with new DFA.
+	 */
+	lexertl::citerator end;
+	const char* position = (m_stateIter != end) ? m_stateIter->first : m_end;
+	m_ruleSetVersion = version;
+	m_autoLexer = m_ruleSet->GetStateMachine();
+	m_stateIter = lexertl::citerator(position, m_end, *m_autoLexer);
+}
+
+size_t CalcLexer::GetTokenId() const
+{
+	// Keywords are matched by id rule and reclassified here,
+	//  so they don't add states to DFA.
+	if (m_keywords && m_stateIter->id == TT_ID)
+	{
+		return m_keywords->Find(GetTokenText());
+	}
+	return m_stateIter->id;
+}
+
+std::string_view CalcLexer::GetTokenText() const
+{
+	return std::string_view(m_stateIter->first, static_cast<size_t>(m_stateIter->second - m_stateIter->first));
+}
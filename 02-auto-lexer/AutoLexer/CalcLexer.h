@@ -1,8 +1,11 @@
 #pragma once
 
-#include <boost/utility/string_view.hpp>
-#include <lexertl/generator.hpp>
+#include <calc-common/KeywordTable.h>
+#include <calc-common/TokenStream.h>
 #include <lexertl/iterator.hpp>
+#include <string_view>
+#include "CalcRuleSet.h"
+#include "CalcStateMachine.h"
 #include "Token.h"
 
 namespace calc
@@ -11,12 +14,47 @@ namespace calc
 class CalcLexer
 {
 public:
-	CalcLexer(const boost::string_view sources);
+	// Creates lexer which uses DFA shared by the whole process.
+	CalcLexer(const std::string_view sources);
+
+	// Creates lexer which uses shared DFA in given mode.
+	CalcLexer(const std::string_view sources, DfaMode mode);
+
+	// Creates lexer which uses given DFA, e.g. built from extended rules.
+	CalcLexer(const std::string_view sources, StateMachinePtr stateMachine);
+
+	// Creates lexer which follows DFA updates of `ruleSet`.
+	// When new DFA is published, lexer continues with it from current token.
+	// `ruleSet` must outlive lexer.
+	CalcLexer(const std::string_view sources, const CalcRuleSet& ruleSet);
+
+	const lexertl::state_machine& GetStateMachine() const;
+
+	// Restarts lexer on new `sources`, keeping its DFA and keywords.
+	// Lexer following rule set switches to its latest DFA.
+	void Reset(std::string_view sources);
+
+	// Makes lexer return keyword types for ids found in `keywords`.
+	// `keywords` must outlive lexer.
+	void SetKeywords(const KeywordTable& keywords);
 
 	Token Read();
 
+	// Reads all remaining tokens into compact `stream`, reusing its capacity.
+	// Throws std::length_error if sources don't fit 32-bit offsets.
+	void ReadAll(TokenStream& stream);
+
 private:
-	std::unique_ptr<lexertl::state_machine> m_autoLexer;
+	void SyncRuleSet();
+	size_t GetTokenId() const;
+	std::string_view GetTokenText() const;
+
+	StateMachinePtr m_autoLexer;
+	const CalcRuleSet* m_ruleSet = nullptr;
+	size_t m_ruleSetVersion = 0;
+	const KeywordTable* m_keywords = nullptr;
+	const char* m_begin = nullptr;
+	const char* m_end = nullptr;
 	lexertl::citerator m_stateIter;
 };
 
@@ -0,0 +1,156 @@
+#include "CalcRuleSet.h"
+#include "Token.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace calc
+{
+namespace
+{
+bool CanBuildRule(const CalcRule& rule)
+{
+	try
+	{
+		BuildCalcStateMachine({ rule });
+		return true;
+	}
+	catch (...)
+	{
+		return false;
+	}
+}
+
+StateMachinePtr BuildWithoutBadRules(std::vector<CalcRule>& rules, size_t goodCount, std::exception_ptr& error)
+{
+	/*
+	 * Some rules pass regex parsing but fail subset construction,
+	 *  e.g. rule matching empty string. Such rules are dropped,
+	 *  so one bad rule doesn't block rules added after it.
+	 * First `goodCount` rules have been built before.
+	 */
+	try
+	{
+		return BuildCalcStateMachine(rules);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	rules.erase(std::remove_if(rules.begin() + goodCount, rules.end(), [](const CalcRule& rule) {
+		return !CanBuildRule(rule);
+	}), rules.end());
+	if (rules.size() > goodCount)
+	{
+		try
+		{
+			return BuildCalcStateMachine(rules);
+		}
+		catch (...)
+		{
+			// New rules fail only together, rolls back to last good rule set.
+		}
+	}
+	rules.resize(goodCount);
+	return nullptr;
+}
+}
+
+CalcRuleSet::CalcRuleSet()
+	: m_stateMachine(GetCalcStateMachine())
+	, m_builder(&CalcRuleSet::RunBuilder, this)
+{
+}
+
+CalcRuleSet::~CalcRuleSet()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_rulesAdded.notify_one();
+	m_builder.join();
+}
+
+void CalcRuleSet::AddRule(const std::string& regex, size_t id)
+{
+	if ((id == 0 || id > TT_CLOSE_BRACKET) && (id < FIRST_CUSTOM_TOKEN || id > LAST_CUSTOM_TOKEN))
+	{
+		throw std::invalid_argument("invalid token id for calc rule: " + std::to_string(id));
+	}
+
+	/*
+	 * lexertl parses regex when rule is pushed,
+	 *  so syntax errors are reported here instead of on builder thread.
+	 */
+	lexertl::rules check;
+	check.push(regex, id);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_rules.push_back(CalcRule{ regex, id });
+	}
+	m_rulesAdded.notify_one();
+}
+
+StateMachinePtr CalcRuleSet::GetStateMachine() const
+{
+	return std::atomic_load(&m_stateMachine);
+}
+
+size_t CalcRuleSet::GetVersion() const
+{
+	return m_version.load(std::memory_order_acquire);
+}
+
+void CalcRuleSet::WaitForRebuild()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_rebuilt.wait(lock, [this] {
+		return m_builtCount == m_rules.size();
+	});
+	if (m_error)
+	{
+		std::rethrow_exception(m_error);
+	}
+}
+
+void CalcRuleSet::RunBuilder()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_rulesAdded.wait(lock, [this] {
+			return m_stopping || m_builtCount != m_rules.size();
+		});
+		if (m_stopping)
+		{
+			return;
+		}
+
+		/*
+		 * Builds from snapshot of rules without holding the lock,
+		 *  so AddRule() never waits for subset construction.
+		 */
+		std::vector<CalcRule> rules = m_rules;
+		const size_t snapshotSize = rules.size();
+		const size_t goodCount = m_builtCount;
+		lock.unlock();
+		std::exception_ptr error;
+		StateMachinePtr stateMachine = BuildWithoutBadRules(rules, goodCount, error);
+		lock.lock();
+
+		if (stateMachine)
+		{
+			std::atomic_store(&m_stateMachine, std::move(stateMachine));
+			m_version.fetch_add(1, std::memory_order_release);
+		}
+		// Rules added during rebuild stay after the built ones.
+		m_rules.erase(m_rules.begin(), m_rules.begin() + snapshotSize);
+		m_rules.insert(m_rules.begin(), rules.begin(), rules.end());
+		m_error = error;
+		m_builtCount = rules.size();
+		m_rebuilt.notify_all();
+	}
+}
+
+}
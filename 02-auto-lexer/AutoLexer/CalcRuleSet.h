@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CalcStateMachine.h"
+
+namespace calc
+{
+
+// Calc rules extended at runtime, e.g. with domain-specific operators and keywords.
+// DFA is rebuilt on background thread and published atomically,
+//  so lexers never wait for rebuild.
+class CalcRuleSet
+{
+public:
+	// Starts with DFA shared by the whole process.
+	CalcRuleSet();
+	~CalcRuleSet();
+
+	CalcRuleSet(const CalcRuleSet&) = delete;
+	CalcRuleSet& operator=(const CalcRuleSet&) = delete;
+
+	// Adds rule which takes priority over calc rules on matches of equal length.
+	// `id` must be calc token type or in [FIRST_CUSTOM_TOKEN, LAST_CUSTOM_TOKEN].
+	// Throws std::invalid_argument on bad id and lexertl::runtime_error on bad regex.
+	// Rules added while rebuild is running are built together by next rebuild.
+	void AddRule(const std::string& regex, size_t id);
+
+	// Returns latest built DFA, never blocks on rebuild.
+	StateMachinePtr GetStateMachine() const;
+
+	// Increases each time new DFA is published.
+	size_t GetVersion() const;
+
+	// Blocks until DFA includes all added rules.
+	// Rethrows exception if last rebuild failed. Rules which fail to build
+	//  are dropped and DFA stays built from the remaining rules.
+	void WaitForRebuild();
+
+private:
+	void RunBuilder();
+
+	std::mutex m_mutex;
+	std::condition_variable m_rulesAdded;
+	std::condition_variable m_rebuilt;
+	std::vector<CalcRule> m_rules;
+	size_t m_builtCount = 0;
+	std::exception_ptr m_error;
+	bool m_stopping = false;
+
+	// Accessed only with std::atomic_load/std::atomic_store.
+	StateMachinePtr m_stateMachine;
+	std::atomic<size_t> m_version{ 0 };
+
+	std::thread m_builder;
+};
+
+}
@@ -0,0 +1,23 @@
+#include "CalcRules.h"
+#include "Token.h"
+
+namespace calc
+{
+
+void AddCalcRules(lexertl::rules& rules)
+{
+	rules.push("[a-zA-Z_][a-zA-Z0-9_]*", calc::TT_ID);
+	rules.push("(0|[1-9][0-9]*)(\\.[0-9]+)?", calc::TT_NUMBER);
+	rules.push("[a-zA-Z0-9_\\.]+", calc::TT_ERROR);
+	rules.push("\\+", calc::TT_PLUS);
+	rules.push("\\-", calc::TT_MINUS);
+	rules.push("\\*", calc::TT_ASTERISK);
+	rules.push("\\/", calc::TT_SLASH);
+	rules.push("\\=", calc::TT_EQUAL);
+	rules.push("\\(", calc::TT_OPEN_BRACKET);
+	rules.push("\\)", calc::TT_CLOSE_BRACKET);
+
+	rules.push("[ \t\r\n]+", rules.skip());
+}
+
+}
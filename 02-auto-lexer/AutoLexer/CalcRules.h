@@ -0,0 +1,19 @@
+#pragma once
+
+#include <lexertl/rules.hpp>
+#include <string>
+
+namespace calc
+{
+
+struct CalcRule
+{
+	std::string regex;
+	size_t id = 0;
+};
+
+// Adds rules of calc grammar to `rules`.
+// After changing rules run AutoLexerGenerator to update precompiled tables.
+void AddCalcRules(lexertl::rules& rules);
+
+}
@@ -0,0 +1,117 @@
+#include "CalcStateMachine.h"
+#include "CalcRules.h"
+#include "CalcStateMachineTables.h"
+#include <algorithm>
+#include <lexertl/generator.hpp>
+
+namespace calc
+{
+namespace
+{
+void LoadPrecompiledTables(lexertl::state_machine& stateMachine)
+{
+	/*
+	 * Copies tables generated by AutoLexerGenerator into state machine,
+	 *  no regex parsing and no subset construction happens here.
+	 */
+	auto& internals = stateMachine.data();
+	internals._eoi = tables::EOI;
+	internals._features = tables::FEATURES;
+	internals.add_states(tables::DFA_COUNT);
+	for (std::size_t dfa = 0; dfa < tables::DFA_COUNT; ++dfa)
+	{
+		std::copy(tables::LOOKUP[dfa], tables::LOOKUP[dfa] + 256, internals._lookup[dfa].begin());
+		internals._dfa_alphabet[dfa] = tables::DFA_ALPHABET[dfa];
+		internals._dfa[dfa].assign(tables::DFA[dfa], tables::DFA[dfa] + tables::DFA_SIZE[dfa]);
+	}
+}
+
+StateMachinePtr LoadMinimisedCalcStateMachine()
+{
+	auto stateMachine = std::make_shared<lexertl::state_machine>();
+	LoadPrecompiledTables(*stateMachine);
+	stateMachine->minimise();
+	return stateMachine;
+}
+}
+
+StateMachineStats GetStateMachineStats(const lexertl::state_machine& stateMachine)
+{
+	using IdType = lexertl::state_machine::id_type;
+
+	const auto& internals = stateMachine.data();
+	StateMachineStats stats;
+	for (std::size_t dfa = 0; dfa < internals._dfa->size(); ++dfa)
+	{
+		/*
+		 * Each state is a row of `alphabet` entries,
+		 *  row 0 is the 'jam' state which isn't counted.
+		 */
+		const std::size_t alphabet = internals._dfa_alphabet[dfa];
+		if (alphabet != 0)
+		{
+			stats.stateCount += internals._dfa[dfa].size() / alphabet - 1;
+		}
+		stats.tableSize += internals._dfa[dfa].size() * sizeof(IdType);
+		stats.tableSize += internals._lookup[dfa].size() * sizeof(IdType);
+	}
+	return stats;
+}
+
+StateMachinePtr BuildCalcStateMachine(DfaMode mode)
+{
+	return BuildCalcStateMachine({}, mode);
+}
+
+StateMachinePtr BuildCalcStateMachine(const std::vector<CalcRule>& extraRules, DfaMode mode)
+{
+	/*
+	 * lexertl prefers earlier rule when matches have equal length,
+	 *  so extra rules go first, e.g. keyword rule wins over id rule.
+	 */
+	lexertl::rules rules;
+	for (const CalcRule& rule : extraRules)
+	{
+		rules.push(rule.regex, rule.id);
+	}
+	AddCalcRules(rules);
+
+	auto stateMachine = std::make_shared<lexertl::state_machine>();
+	lexertl::generator::build(rules, *stateMachine);
+
+	if (mode == DfaMode::Minimised)
+	{
+		stateMachine->minimise();
+	}
+
+	return stateMachine;
+}
+
+StateMachinePtr LoadPrecompiledCalcStateMachine()
+{
+	auto stateMachine = std::make_shared<lexertl::state_machine>();
+	LoadPrecompiledTables(*stateMachine);
+	return stateMachine;
+}
+
+const StateMachinePtr& GetCalcStateMachine(DfaMode mode)
+{
+	// Initialization of function-local static is thread-safe since C++11.
+	if (mode == DfaMode::Minimised)
+	{
+		static const StateMachinePtr minimised = LoadMinimisedCalcStateMachine();
+		return minimised;
+	}
+	static const StateMachinePtr unminimised = LoadPrecompiledCalcStateMachine();
+	return unminimised;
+}
+
+MinimisationStats GetCalcMinimisationStats()
+{
+	MinimisationStats stats;
+	stats.before = GetStateMachineStats(*GetCalcStateMachine(DfaMode::Unminimised));
+	stats.after = GetStateMachineStats(*GetCalcStateMachine(DfaMode::Minimised));
+	return stats;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CalcRules.h"
+#include <lexertl/state_machine.hpp>
+#include <memory>
+#include <vector>
+
+namespace calc
+{
+
+using StateMachinePtr = std::shared_ptr<const lexertl::state_machine>;
+
+enum class DfaMode
+{
+	// DFA as it comes from subset construction.
+	Unminimised,
+	// Equivalent states are merged, tables are smaller.
+	// Minimisation costs extra build time, so callers opt into it.
+	Minimised,
+};
+
+struct StateMachineStats
+{
+	size_t stateCount = 0;
+	// Size of transition tables and char lookup tables in bytes.
+	size_t tableSize = 0;
+};
+
+struct MinimisationStats
+{
+	StateMachineStats before;
+	StateMachineStats after;
+};
+
+StateMachineStats GetStateMachineStats(const lexertl::state_machine& stateMachine);
+
+// Builds new DFA for calc grammar from rules.
+StateMachinePtr BuildCalcStateMachine(DfaMode mode = DfaMode::Unminimised);
+
+// Builds new DFA for calc grammar extended with `extraRules`.
+// Extra rules take priority over calc rules on matches of equal length.
+StateMachinePtr BuildCalcStateMachine(const std::vector<CalcRule>& extraRules, DfaMode mode = DfaMode::Unminimised);
+
+// Creates DFA for calc grammar from tables precompiled at build time.
+StateMachinePtr LoadPrecompiledCalcStateMachine();
+
+// Returns DFA for calc grammar shared by the whole process.
+// Unminimised DFA is loaded from precompiled tables, minimised one
+//  is minimised from them on the first call; both are thread-safe and immutable.
+const StateMachinePtr& GetCalcStateMachine(DfaMode mode = DfaMode::Unminimised);
+
+// Compares shared unminimised and minimised DFA for calc grammar.
+MinimisationStats GetCalcMinimisationStats();
+
+}
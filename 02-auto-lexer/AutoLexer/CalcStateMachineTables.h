@@ -0,0 +1,72 @@
+#pragma once
+
+// Generated by AutoLexerGenerator from calc rules, do not edit.
+
+#include <cstddef>
+
+namespace calc
+{
+namespace tables
+{
+
+constexpr std::size_t NPOS = static_cast<std::size_t>(~0);
+constexpr std::size_t SKIP = static_cast<std::size_t>(~1);
+
+constexpr std::size_t EOI = 0;
+constexpr std::size_t FEATURES = 4;
+constexpr std::size_t DFA_COUNT = 1;
+
+constexpr std::size_t LOOKUP_0[] = {
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 7, 7, 6, 6, 7, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	7, 6, 6, 6, 6, 6, 6, 6, 8, 9, 10, 11, 6, 12, 13, 16,
+	17, 15, 15, 15, 15, 15, 15, 15, 15, 15, 6, 6, 6, 18, 6, 6,
+	6, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+	14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 6, 6, 6, 6, 14,
+	6, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+	14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+};
+
+constexpr std::size_t DFA_0[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 13, 11, 12, 8, 6, 7,
+	5, 2, 4, 9, 3, 10, 1, 3, NPOS, NPOS, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 5, 2, 2, 0, 2, 0, 1, 2, NPOS, NPOS, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 14, 5, 5, 0, 5, 0, 1, 2, NPOS, NPOS,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 5, 4, 0, 4, 0, 1,
+	1, NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 5, 5, 0,
+	5, 0, 1, 4, NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 1, 5, NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 6, NPOS, NPOS, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 7, NPOS, NPOS, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 8,
+	NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 9, NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 1, 10, NPOS, NPOS, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 1, SKIP, NPOS, NPOS, 0, 0, 0, 13, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, NPOS, NPOS, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 5, 5, 15, 0, 15, 0, 1, 2, NPOS,
+	NPOS, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 5, 15, 0, 15, 0,
+};
+
+constexpr const std::size_t* LOOKUP[] = { LOOKUP_0, };
+constexpr const std::size_t* DFA[] = { DFA_0, };
+
+constexpr std::size_t DFA_ALPHABET[] = {
+	19,
+};
+
+constexpr std::size_t DFA_SIZE[] = {
+	304,
+};
+
+}
+}
@@ -0,0 +1,111 @@
+#include "FastCalcLexer.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace calc
+{
+namespace
+{
+constexpr bool FitsCompactId(const std::size_t* values, std::size_t size)
+{
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		if (values[i] != tables::NPOS && values[i] != tables::SKIP
+			&& values[i] >= std::numeric_limits<uint16_t>::max() - 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(tables::DFA_COUNT == 1, "compact DFA supports only one lexer state");
+static_assert(FitsCompactId(tables::LOOKUP_0, 256) && FitsCompactId(tables::DFA_0, tables::DFA_SIZE[0]),
+	"precompiled tables don't fit 16-bit ids");
+
+uint16_t ToCompactId(std::size_t value)
+{
+	if (value == tables::NPOS)
+	{
+		return CompactStateMachine::npos();
+	}
+	if (value == tables::SKIP)
+	{
+		return CompactStateMachine::skip();
+	}
+	return static_cast<uint16_t>(value);
+}
+}
+
+CompactStateMachinePtr LoadCompactCalcStateMachine()
+{
+	auto stateMachine = std::make_shared<CompactStateMachine>();
+	auto& internals = stateMachine->data();
+	internals._eoi = ToCompactId(tables::EOI);
+	internals._features = tables::FEATURES;
+	internals.add_states(tables::DFA_COUNT);
+	for (std::size_t dfa = 0; dfa < tables::DFA_COUNT; ++dfa)
+	{
+		std::transform(tables::LOOKUP[dfa], tables::LOOKUP[dfa] + 256,
+			internals._lookup[dfa].begin(), ToCompactId);
+		internals._dfa_alphabet[dfa] = ToCompactId(tables::DFA_ALPHABET[dfa]);
+		internals._dfa[dfa].resize(tables::DFA_SIZE[dfa]);
+		std::transform(tables::DFA[dfa], tables::DFA[dfa] + tables::DFA_SIZE[dfa],
+			internals._dfa[dfa].begin(), ToCompactId);
+	}
+	return stateMachine;
+}
+
+const CompactStateMachinePtr& GetCompactCalcStateMachine()
+{
+	static const CompactStateMachinePtr stateMachine = LoadCompactCalcStateMachine();
+	return stateMachine;
+}
+
+FastCalcLexer::FastCalcLexer(const std::string_view sources)
+	: m_stateMachine(GetCompactCalcStateMachine())
+	, m_begin(sources.data())
+	, m_end(sources.data() + sources.size())
+	, m_stateIter(m_begin, m_end, *m_stateMachine)
+{
+}
+
+void FastCalcLexer::Reset(std::string_view sources)
+{
+	m_begin = sources.data();
+	m_end = sources.data() + sources.size();
+	m_stateIter = CompactIterator(m_begin, m_end, *m_stateMachine);
+}
+
+Token FastCalcLexer::Read()
+{
+	CompactIterator end;
+	if (m_stateIter != end)
+	{
+		const Token result = MakeToken(m_stateIter->id,
+			std::string_view(m_stateIter->first, static_cast<size_t>(m_stateIter->second - m_stateIter->first)),
+			static_cast<size_t>(m_stateIter->first - m_begin));
+		++m_stateIter;
+		return result;
+	}
+	return Token{ TT_END, std::nullopt, static_cast<size_t>(m_end - m_begin) };
+}
+
+void FastCalcLexer::ReadAll(TokenStream& stream)
+{
+	CompactIterator end;
+	if (m_stateIter != end && m_stateIter->eoi - m_begin > UINT32_MAX)
+	{
+		throw std::length_error("sources are too large for TokenStream");
+	}
+	stream.Clear();
+	for (; m_stateIter != end; ++m_stateIter)
+	{
+		stream.Push(ToTokenType(m_stateIter->id),
+			static_cast<uint32_t>(m_stateIter->first - m_begin),
+			static_cast<uint32_t>(m_stateIter->second - m_stateIter->first));
+	}
+}
+
+}
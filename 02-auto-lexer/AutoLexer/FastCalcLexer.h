@@ -0,0 +1,54 @@
+#pragma once
+
+#include <calc-common/TokenStream.h>
+#include <cstdint>
+#include <lexertl/iterator.hpp>
+#include <memory>
+#include <string_view>
+#include "CalcStateMachineTables.h"
+#include "Token.h"
+
+namespace calc
+{
+
+// DFA with 16-bit table entries, 4 times smaller than default one on 64-bit.
+using CompactStateMachine = lexertl::basic_state_machine<char, uint16_t>;
+using CompactStateMachinePtr = std::shared_ptr<const CompactStateMachine>;
+
+// Lookup flags are fixed at compile time to features used by calc rules,
+//  so bol/eol, multi-state and recursion code is not instantiated.
+// advance_bit makes lookup skip chars which don't match any rule.
+using CompactMatch = lexertl::match_results<const char*, uint16_t,
+	tables::FEATURES | lexertl::advance_bit>;
+using CompactIterator = lexertl::iterator<const char*, CompactStateMachine, CompactMatch>;
+
+// Creates compact DFA for calc grammar from precompiled tables.
+CompactStateMachinePtr LoadCompactCalcStateMachine();
+
+// Returns compact DFA for calc grammar shared by the whole process.
+const CompactStateMachinePtr& GetCompactCalcStateMachine();
+
+// Same as CalcLexer, but runs on compact DFA with specialized lookup.
+// Supports only precompiled calc rules.
+class FastCalcLexer
+{
+public:
+	FastCalcLexer(const std::string_view sources);
+
+	// Restarts lexer on new `sources`, keeping its DFA.
+	void Reset(std::string_view sources);
+
+	Token Read();
+
+	// Reads all remaining tokens into compact `stream`, reusing its capacity.
+	// Throws std::length_error if sources don't fit 32-bit offsets.
+	void ReadAll(TokenStream& stream);
+
+private:
+	CompactStateMachinePtr m_stateMachine;
+	const char* m_begin = nullptr;
+	const char* m_end = nullptr;
+	CompactIterator m_stateIter;
+};
+
+}
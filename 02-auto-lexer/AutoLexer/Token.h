@@ -1,53 +1,33 @@
 #pragma once
 
-#include <string>
-#include <boost/optional.hpp>
+#include <calc-common/Token.h>
+#include <cstddef>
+#include <optional>
+#include <string_view>
 
 namespace calc
 {
 
-enum TokenType
+inline TokenType ToTokenType(size_t number)
 {
-	TT_END = 0,
-	TT_ERROR = 1,
-	TT_NUMBER,
-	TT_ID,
-	TT_PLUS,
-	TT_MINUS,
-	TT_ASTERISK,
-	TT_SLASH,
-	TT_EQUAL,
-	TT_OPEN_BRACKET,
-	TT_CLOSE_BRACKET,
-};
+	if ((number > 0 && number <= TokenType::TT_CLOSE_BRACKET)
+		|| (number >= FIRST_CUSTOM_TOKEN && number <= LAST_CUSTOM_TOKEN))
+	{
+		return static_cast<TokenType>(number);
+	}
+	return TT_ERROR;
+}
 
-struct Token
+// Creates token for rule `id` matched at `offset`,
+//  value refers to `text` only for tokens which have value.
+inline Token MakeToken(size_t id, std::string_view text, size_t offset)
 {
-	TokenType type = TT_END;
-	boost::optional<std::string> value;
-	
-	Token(TokenType type, std::string str)
-		:type(type), value(str)
-	{}
-	Token(size_t number, std::string str)
+	const TokenType type = ToTokenType(id);
+	if (HasValue(type))
 	{
-		if (number > 0 && number <= TokenType::TT_CLOSE_BRACKET)
-		{
-			type = static_cast<TokenType>(number);
-		}
-		else
-		{
-			type = TT_ERROR;
-		}
-		if (type == TT_NUMBER || type == TT_ID || type == TT_ERROR)
-		{
-			value = str;
-		}
+		return Token{ type, text, offset };
 	}
-	Token(TokenType type)
-		:type(type), value()
-	{}
-};
-
+	return Token{ type, std::nullopt, offset };
+}
 
 }
@@ -0,0 +1,52 @@
+#define CALC_BENCH_IMPLEMENT // This adds allocation counter - only do this in one cpp file
+#include <calc-bench/CalcBench.h>
+#include "../AutoLexer/CalcLexer.h"
+#include "../AutoLexer/FastCalcLexer.h"
+
+using namespace calc;
+
+int main(int argc, char* argv[])
+{
+	const MinimisationStats stats = GetCalcMinimisationStats();
+	std::printf("DFA states: %zu -> %zu, table size: %zu -> %zu bytes\n",
+		stats.before.stateCount, stats.after.stateCount, stats.before.tableSize, stats.after.tableSize);
+
+	TokenStream stream;
+	return calc_bench::RunBenchmarks(argc, argv, {
+		{ "AutoLexer/Read", [](const std::string& text) {
+			CalcLexer lexer{ text };
+			size_t count = 0;
+			for (Token token = lexer.Read(); token.type != TT_END; token = lexer.Read())
+			{
+				++count;
+			}
+			return count;
+		} },
+		{ "AutoLexer/ReadMinimised", [](const std::string& text) {
+			CalcLexer lexer{ text, DfaMode::Minimised };
+			size_t count = 0;
+			for (Token token = lexer.Read(); token.type != TT_END; token = lexer.Read())
+			{
+				++count;
+			}
+			return count;
+		} },
+		{ "AutoLexer/TokenStream", [&](const std::string& text) {
+			CalcLexer{ text }.ReadAll(stream);
+			return stream.Size();
+		} },
+		{ "AutoLexer/FastRead", [](const std::string& text) {
+			FastCalcLexer lexer{ text };
+			size_t count = 0;
+			for (Token token = lexer.Read(); token.type != TT_END; token = lexer.Read())
+			{
+				++count;
+			}
+			return count;
+		} },
+		{ "AutoLexer/FastTokenStream", [&](const std::string& text) {
+			FastCalcLexer{ text }.ReadAll(stream);
+			return stream.Size();
+		} },
+	});
+}
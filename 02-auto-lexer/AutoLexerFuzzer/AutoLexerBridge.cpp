@@ -0,0 +1,19 @@
+#include "LexerBridge.h"
+#include "../AutoLexer/CalcLexer.h"
+
+namespace calc_fuzz
+{
+
+void LexAuto(std::string_view sources, std::vector<FlatToken>& tokens)
+{
+	// Stream is reused to keep allocations out of throughput numbers.
+	static thread_local calc::TokenStream stream;
+	calc::CalcLexer(sources).ReadAll(stream);
+	tokens.resize(stream.Size());
+	for (size_t i = 0; i < stream.Size(); ++i)
+	{
+		tokens[i] = FlatToken{ static_cast<uint8_t>(stream.GetType(i)), stream.GetOffset(i), stream.GetLength(i) };
+	}
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Both lexers are seen by fuzzer through these functions only,
+//  so it doesn't depend on their headers and token types.
+namespace calc_fuzz
+{
+
+struct FlatToken
+{
+	uint8_t type = 0; // value of TokenType, same in both lexers
+	uint32_t offset = 0;
+	uint32_t length = 0;
+};
+
+// Replaces `tokens` with all tokens of `sources` read by ManualLexer.
+void LexManual(std::string_view sources, std::vector<FlatToken>& tokens);
+
+// Replaces `tokens` with all tokens of `sources` read by AutoLexer.
+void LexAuto(std::string_view sources, std::vector<FlatToken>& tokens);
+
+}
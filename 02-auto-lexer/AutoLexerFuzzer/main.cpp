@@ -0,0 +1,391 @@
+#include "LexerBridge.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Differential fuzzer for ManualLexer and AutoLexer.
+ * Feeds the same input to both lexers and reports first difference
+ *  in token type, offset, length or count, together with throughput
+ *  of each lexer on all inputs seen.
+ * Build with -DCALC_FUZZ_LIBFUZZER and -fsanitize=fuzzer to run under libFuzzer,
+ *  otherwise it's a standalone driver with random input generator.
+ */
+
+using namespace calc_fuzz;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct LexerStats
+{
+	double seconds = 0;
+	size_t bytes = 0;
+	size_t tokens = 0;
+};
+
+struct FuzzStats
+{
+	LexerStats manual;
+	LexerStats automatic;
+	size_t inputs = 0;
+	size_t divergences = 0;
+};
+
+FuzzStats g_stats;
+
+const char* GetTokenName(uint8_t type)
+{
+	static const char* const names[] = { "end", "error", "number", "id", "+", "-", "*", "/", "=", "(", ")" };
+	return type < std::size(names) ? names[type] : "<custom>";
+}
+
+std::string Escape(std::string_view text)
+{
+	std::string result;
+	for (const char ch : text)
+	{
+		const auto code = static_cast<unsigned char>(ch);
+		if (ch == '\\' || ch == '"')
+		{
+			result += '\\';
+			result += ch;
+		}
+		else if (code >= 0x20 && code < 0x7F)
+		{
+			result += ch;
+		}
+		else
+		{
+			char buffer[8];
+			std::snprintf(buffer, sizeof(buffer), "\\x%02X", code);
+			result += buffer;
+		}
+	}
+	return result;
+}
+
+template <class LexFunction>
+void Lex(LexFunction lex, std::string_view input, std::vector<FlatToken>& tokens, LexerStats& stats)
+{
+	const auto start = Clock::now();
+	lex(input, tokens);
+	stats.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+	stats.bytes += input.size();
+	stats.tokens += tokens.size();
+}
+
+bool operator==(const FlatToken& a, const FlatToken& b)
+{
+	return a.type == b.type && a.offset == b.offset && a.length == b.length;
+}
+
+// Returns index of first different token, or npos if lexers agree.
+size_t FindDivergence(const std::vector<FlatToken>& manual, const std::vector<FlatToken>& automatic)
+{
+	const size_t count = std::min(manual.size(), automatic.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!(manual[i] == automatic[i]))
+		{
+			return i;
+		}
+	}
+	return manual.size() == automatic.size() ? std::string_view::npos : count;
+}
+
+enum class DivergenceKind
+{
+	None,
+	Count,
+	Type,
+	Offset,
+	Length,
+};
+
+// What differs at the first different token, used to tell one bug from another.
+struct Divergence
+{
+	DivergenceKind kind = DivergenceKind::None;
+	uint8_t manualType = 0; // type of manual lexer token, 0 if it has no token there
+	uint8_t autoType = 0;   // same for AutoLexer
+
+	bool operator==(const Divergence& other) const
+	{
+		return kind == other.kind && manualType == other.manualType && autoType == other.autoType;
+	}
+};
+
+const char* GetDivergenceName(DivergenceKind kind)
+{
+	static const char* const names[] = { "none", "count", "type", "offset", "length" };
+	return names[static_cast<size_t>(kind)];
+}
+
+Divergence DescribeDivergence(const std::vector<FlatToken>& manual, const std::vector<FlatToken>& automatic, size_t index)
+{
+	Divergence divergence;
+	if (index == std::string_view::npos)
+	{
+		return divergence;
+	}
+	divergence.manualType = index < manual.size() ? manual[index].type : 0;
+	divergence.autoType = index < automatic.size() ? automatic[index].type : 0;
+	if (index >= manual.size() || index >= automatic.size())
+	{
+		divergence.kind = DivergenceKind::Count;
+	}
+	else if (manual[index].type != automatic[index].type)
+	{
+		divergence.kind = DivergenceKind::Type;
+	}
+	else if (manual[index].offset != automatic[index].offset)
+	{
+		divergence.kind = DivergenceKind::Offset;
+	}
+	else
+	{
+		divergence.kind = DivergenceKind::Length;
+	}
+	return divergence;
+}
+
+Divergence FindInputDivergence(std::string_view input)
+{
+	std::vector<FlatToken> manual;
+	std::vector<FlatToken> automatic;
+	LexManual(input, manual);
+	LexAuto(input, automatic);
+	return DescribeDivergence(manual, automatic, FindDivergence(manual, automatic));
+}
+
+std::string Minimize(std::string input, const Divergence& original)
+{
+	/*
+	 * Removes chars one by one while lexers still disagree the same way,
+	 *  so report shows the smallest input with the same problem
+	 *  rather than some other divergence found on the way.
+	 */
+	for (size_t i = 0; i < input.size();)
+	{
+		std::string smaller = input;
+		smaller.erase(i, 1);
+		if (FindInputDivergence(smaller) == original)
+		{
+			input = std::move(smaller);
+		}
+		else
+		{
+			++i;
+		}
+	}
+	return input;
+}
+
+void PrintToken(const char* lexer, std::string_view input, const std::vector<FlatToken>& tokens, size_t index)
+{
+	if (index >= tokens.size())
+	{
+		std::fprintf(stderr, "  %-6s: <no token>, %zu tokens total\n", lexer, tokens.size());
+		return;
+	}
+	const FlatToken& token = tokens[index];
+	std::fprintf(stderr, "  %-6s: %s at %u \"%s\", %zu tokens total\n", lexer, GetTokenName(token.type),
+		token.offset, Escape(input.substr(token.offset, token.length)).c_str(), tokens.size());
+}
+
+// Lexes input with both lexers, returns false and prints report on divergence.
+bool CheckInput(std::string_view input)
+{
+	static std::vector<FlatToken> manual;
+	static std::vector<FlatToken> automatic;
+	Lex(LexManual, input, manual, g_stats.manual);
+	Lex(LexAuto, input, automatic, g_stats.automatic);
+	++g_stats.inputs;
+
+	const size_t index = FindDivergence(manual, automatic);
+	if (index == std::string_view::npos)
+	{
+		return true;
+	}
+
+	++g_stats.divergences;
+	const Divergence divergence = DescribeDivergence(manual, automatic, index);
+	std::fprintf(stderr, "Lexers diverge on \"%s\" at token %zu, %s differs:\n",
+		Escape(input).c_str(), index, GetDivergenceName(divergence.kind));
+	PrintToken("manual", input, manual, index);
+	PrintToken("auto", input, automatic, index);
+	std::fprintf(stderr, "  minimized input: \"%s\"\n", Escape(Minimize(std::string(input), divergence)).c_str());
+	return false;
+}
+
+void PrintLexerStats(const char* name, const LexerStats& stats)
+{
+	const double seconds = std::max(stats.seconds, 1e-9);
+	std::printf("%-6s %10.1f MB/s %10.2f Mtokens/s\n", name,
+		static_cast<double>(stats.bytes) / seconds / (1024 * 1024),
+		static_cast<double>(stats.tokens) / seconds / 1e6);
+}
+
+void PrintStats()
+{
+	std::printf("inputs: %zu, bytes: %zu, divergences: %zu\n",
+		g_stats.inputs, g_stats.manual.bytes, g_stats.divergences);
+	PrintLexerStats("manual", g_stats.manual);
+	PrintLexerStats("auto", g_stats.automatic);
+}
+}
+
+#if defined(CALC_FUZZ_LIBFUZZER)
+
+namespace
+{
+// libFuzzer calls exit() when it's done, so stats are printed from destructor.
+struct StatsPrinter
+{
+	~StatsPrinter()
+	{
+		PrintStats();
+	}
+} g_statsPrinter;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	if (!CheckInput(std::string_view(reinterpret_cast<const char*>(data), size)))
+	{
+		PrintStats();
+		std::abort();
+	}
+	return 0;
+}
+
+#else
+
+namespace
+{
+struct Options
+{
+	size_t iterations = 1000000;
+	size_t maxLength = 64;
+	size_t maxFailures = 10;
+	unsigned seed = std::random_device{}();
+	std::vector<std::string> files;
+};
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		const size_t equal = arg.find('=');
+		const std::string_view name = arg.substr(0, equal);
+		const std::string value{ equal == std::string_view::npos ? std::string_view() : arg.substr(equal + 1) };
+		if (name == "--iterations" && !value.empty())
+		{
+			options.iterations = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (name == "--max-length" && !value.empty())
+		{
+			options.maxLength = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (name == "--max-failures" && !value.empty())
+		{
+			options.maxFailures = std::strtoull(value.c_str(), nullptr, 10);
+		}
+		else if (name == "--seed" && !value.empty())
+		{
+			options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+		}
+		else if (!arg.empty() && arg[0] != '-')
+		{
+			options.files.emplace_back(arg);
+		}
+		else
+		{
+			std::fprintf(stderr,
+				"Usage: %s [--iterations=1000000] [--max-length=64] [--max-failures=10] [--seed=<n>] [<input file>...]\n"
+				"  Checks given files, or random inputs if no files given.\n",
+				argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Generates input mostly from chars meaningful for calc grammar.
+std::string GenerateInput(std::mt19937& random, size_t maxLength)
+{
+	static const std::string_view groups[] = {
+		"0123456789",
+		"abcxyzABCXYZ_",
+		".",
+		"+-*/=()",
+		" \t\n\r",
+	};
+	static const unsigned weights[] = { 30, 25, 10, 15, 10, 10 };
+	std::discrete_distribution<size_t> pickGroup(std::begin(weights), std::end(weights));
+	std::uniform_int_distribution<int> anyByte(0, 255);
+
+	std::string input(std::uniform_int_distribution<size_t>(0, maxLength)(random), '\0');
+	for (char& ch : input)
+	{
+		const size_t group = pickGroup(random);
+		if (group < std::size(groups))
+		{
+			ch = groups[group][random() % groups[group].size()];
+		}
+		else
+		{
+			ch = static_cast<char>(anyByte(random));
+		}
+	}
+	return input;
+}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+
+	if (!options.files.empty())
+	{
+		for (const std::string& path : options.files)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file)
+			{
+				std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+				return 2;
+			}
+			CheckInput(std::string{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() });
+		}
+	}
+	else
+	{
+		std::printf("seed: %u\n", options.seed);
+		std::mt19937 random(options.seed);
+		for (size_t i = 0; i < options.iterations && g_stats.divergences < options.maxFailures; ++i)
+		{
+			CheckInput(GenerateInput(random, options.maxLength));
+		}
+	}
+
+	PrintStats();
+	return g_stats.divergences == 0 ? 0 : 1;
+}
+
+#endif
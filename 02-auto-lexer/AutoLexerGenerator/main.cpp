@@ -0,0 +1,127 @@
+#include "../AutoLexer/CalcRules.h"
+#include <lexertl/generator.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+namespace
+{
+using Internals = lexertl::state_machine::internals;
+using IdType = lexertl::state_machine::id_type;
+
+std::string FormatValue(IdType value)
+{
+	/*
+	 * npos and skip depend on size_t width, so they are written symbolically
+	 *  to keep tables valid for both 32-bit and 64-bit builds.
+	 */
+	if (value == lexertl::state_machine::npos())
+	{
+		return "NPOS";
+	}
+	if (value == lexertl::state_machine::skip())
+	{
+		return "SKIP";
+	}
+	return std::to_string(value);
+}
+
+void WriteArray(std::ostream& out, const std::string& name, const std::vector<IdType>& values)
+{
+	out << "constexpr std::size_t " << name << "[] = {";
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		out << (i % 16 == 0 ? "\n\t" : " ") << FormatValue(values[i]) << ",";
+	}
+	out << "\n};\n\n";
+}
+
+void WritePointerArray(std::ostream& out, const std::string& name, const std::string& prefix, size_t count)
+{
+	out << "constexpr const std::size_t* " << name << "[] = {";
+	for (size_t i = 0; i < count; ++i)
+	{
+		out << " " << prefix << i << ",";
+	}
+	out << " };\n";
+}
+
+std::string GenerateTables(const Internals& internals)
+{
+	const size_t dfaCount = internals._dfa->size();
+	std::ostringstream out;
+	out << "#pragma once\n"
+		<< "\n"
+		<< "// Generated by AutoLexerGenerator from calc rules, do not edit.\n"
+		<< "\n"
+		<< "#include <cstddef>\n"
+		<< "\n"
+		<< "namespace calc\n"
+		<< "{\n"
+		<< "namespace tables\n"
+		<< "{\n"
+		<< "\n"
+		<< "constexpr std::size_t NPOS = static_cast<std::size_t>(~0);\n"
+		<< "constexpr std::size_t SKIP = static_cast<std::size_t>(~1);\n"
+		<< "\n"
+		<< "constexpr std::size_t EOI = " << FormatValue(internals._eoi) << ";\n"
+		<< "constexpr std::size_t FEATURES = " << internals._features << ";\n"
+		<< "constexpr std::size_t DFA_COUNT = " << dfaCount << ";\n"
+		<< "\n";
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		WriteArray(out, "LOOKUP_" + std::to_string(dfa), internals._lookup[dfa]);
+		WriteArray(out, "DFA_" + std::to_string(dfa), internals._dfa[dfa]);
+	}
+	WritePointerArray(out, "LOOKUP", "LOOKUP_", dfaCount);
+	WritePointerArray(out, "DFA", "DFA_", dfaCount);
+	out << "\n";
+	WriteArray(out, "DFA_ALPHABET", internals._dfa_alphabet);
+	std::vector<IdType> sizes;
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		sizes.push_back(internals._dfa[dfa].size());
+	}
+	WriteArray(out, "DFA_SIZE", sizes);
+	out << "}\n"
+		<< "}\n";
+	return out.str();
+}
+}
+
+// Builds DFA for calc rules and writes its tables as C++ header,
+//  so AutoLexer doesn't build DFA at runtime.
+// Header is rewritten only if tables have changed.
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <output header>\n";
+		return 1;
+	}
+
+	lexertl::rules rules;
+	calc::AddCalcRules(rules);
+	lexertl::state_machine stateMachine;
+	lexertl::generator::build(rules, stateMachine);
+	const std::string tables = GenerateTables(stateMachine.data());
+
+	std::ifstream existing(argv[1], std::ios::binary);
+	const std::string previous{ std::istreambuf_iterator<char>(existing), std::istreambuf_iterator<char>() };
+	if (previous == tables)
+	{
+		return 0;
+	}
+	existing.close();
+
+	std::ofstream output(argv[1], std::ios::binary);
+	output << tables;
+	if (!output)
+	{
+		std::cerr << "Cannot write " << argv[1] << "\n";
+		return 1;
+	}
+	return 0;
+}
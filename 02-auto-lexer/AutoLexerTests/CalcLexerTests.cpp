@@ -1,5 +1,9 @@
 #include <catch2/catch.hpp>
+#include <calc-bench/CalcBench.h>
+#include <calc-common/LineIndex.h>
 #include "../AutoLexer/CalcLexer.h"
+#include "../AutoLexer/FastCalcLexer.h"
+#include <thread>
 #include <vector>
 
 using namespace calc;
@@ -11,7 +15,7 @@ bool operator ==(const Token& a, const Token& b)
 	return a.type == b.type && a.value == b.value;
 }
 
-boost::string_view GetTokenName(TokenType type)
+std::string_view GetTokenName(TokenType type)
 {
 	switch (type)
 	{
@@ -58,7 +62,7 @@ namespace
 
 using TokenList = std::vector<Token>;
 
-TokenList Tokenize(boost::string_view text)
+TokenList Tokenize(std::string_view text)
 {
 	TokenList results;
 	CalcLexer lexer{ text };
@@ -69,6 +73,22 @@ TokenList Tokenize(boost::string_view text)
 	return results;
 }
 
+std::vector<std::string> GetComparisonCorpus()
+{
+	std::vector<std::string> corpus = {
+		"", " ", "\t\r\n", "0", "0.5", "01", "1.", ".1", "1..2", "1.2.3", "12abc",
+		"a", "a1", "_", "_a_1", "a.b", "x = (a + 1) * b / 2 - c", "#$@", "a#b",
+		"  42 \n\t x1=(y2*3.25)",
+	};
+	using calc_bench::CorpusKind;
+	for (CorpusKind kind : { CorpusKind::Numbers, CorpusKind::Ids, CorpusKind::Operators,
+		CorpusKind::Whitespace, CorpusKind::Errors })
+	{
+		corpus.push_back(calc_bench::GenerateCorpus(kind, 64 * 1024));
+	}
+	return corpus;
+}
+
 }
 
 TEST_CASE("Can read one number", "[CalcLexer]") {
@@ -355,3 +375,403 @@ TEST_CASE("Can read statment with whitespaces", "[CalcLexer]") {
 		Token{ TT_NUMBER, "9" },
 		});
 }
+
+TEST_CASE("Can read tokens into compact stream", "[CalcLexer]") {
+	const std::string_view text = " ab = 1.5 *\t(c)";
+	TokenStream stream;
+	CalcLexer{ text }.ReadAll(stream);
+	REQUIRE(stream.GetTypes() == std::vector<uint8_t>{
+		TT_ID, TT_EQUAL, TT_NUMBER, TT_ASTERISK, TT_OPEN_BRACKET, TT_ID, TT_CLOSE_BRACKET,
+		});
+	REQUIRE(stream.GetOffsets() == std::vector<uint32_t>{ 1, 4, 6, 10, 12, 13, 14 });
+	REQUIRE(stream.GetLengths() == std::vector<uint32_t>{ 2, 1, 3, 1, 1, 1, 1 });
+	REQUIRE(stream.GetToken(0, text) == Token{ TT_ID, "ab" });
+	REQUIRE(stream.GetToken(2, text) == Token{ TT_NUMBER, "1.5" });
+	REQUIRE(stream.GetToken(3, text) == Token{ TT_ASTERISK });
+}
+
+TEST_CASE("Tokens have offsets in sources", "[CalcLexer]") {
+	const TokenList tokens = Tokenize("  ab = 1.5 *\t(c)");
+	std::vector<size_t> offsets;
+	for (const Token& token : tokens)
+	{
+		offsets.push_back(token.offset);
+	}
+	REQUIRE(offsets == std::vector<size_t>{ 2, 5, 7, 11, 13, 14, 15 });
+}
+
+TEST_CASE("Line index converts offsets to lines and columns", "[LineIndex]") {
+	const std::string_view text = "a = 1\n\nb = a +\n  2.5";
+	const LineIndex index{ text };
+	const auto checkLocation = [&](size_t offset, size_t line, size_t column) {
+		const SourceLocation location = index.GetLocation(offset);
+		REQUIRE(location.line == line);
+		REQUIRE(location.column == column);
+	};
+	checkLocation(0, 1, 1);
+	checkLocation(4, 1, 5);
+	checkLocation(5, 1, 6);
+	checkLocation(6, 2, 1);
+	checkLocation(7, 3, 1);
+	checkLocation(13, 3, 7);
+	checkLocation(17, 4, 3);
+	checkLocation(text.size(), 4, 6);
+}
+
+TEST_CASE("Line index can be shared by concurrent readers", "[LineIndex]") {
+	std::string text;
+	for (int i = 0; i < 1000; ++i)
+	{
+		text += "a + 1\n";
+	}
+	const LineIndex index{ text };
+	std::vector<SourceLocation> locations(8);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < locations.size(); ++i)
+	{
+		threads.emplace_back([&, i] {
+			locations[i] = index.GetLocation(6 * 500 + 4);
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	for (const SourceLocation& location : locations)
+	{
+		REQUIRE(location.line == 501);
+		REQUIRE(location.column == 5);
+	}
+}
+
+TEST_CASE("Lexers share one state machine", "[CalcLexer]") {
+	CalcLexer first{ "a + 1" };
+	CalcLexer second{ "b * 2" };
+	REQUIRE(&first.GetStateMachine() == &second.GetStateMachine());
+	REQUIRE(&first.GetStateMachine() == GetCalcStateMachine().get());
+}
+
+TEST_CASE("Lexer can use injected state machine", "[CalcLexer]") {
+	const StateMachinePtr stateMachine = BuildCalcStateMachine();
+	CalcLexer lexer{ "x = 0.5", stateMachine };
+	REQUIRE(&lexer.GetStateMachine() == stateMachine.get());
+	REQUIRE(lexer.Read() == Token{ TT_ID, "x" });
+	REQUIRE(lexer.Read() == Token{ TT_EQUAL });
+	REQUIRE(lexer.Read() == Token{ TT_NUMBER, "0.5" });
+	REQUIRE(lexer.Read() == Token{ TT_END });
+}
+
+TEST_CASE("Precompiled state machine matches rules", "[CalcLexer]") {
+	// Machines must outlive references to their internals.
+	const StateMachinePtr builtMachine = BuildCalcStateMachine();
+	const StateMachinePtr loadedMachine = LoadPrecompiledCalcStateMachine();
+	const auto& built = builtMachine->data();
+	const auto& loaded = loadedMachine->data();
+	REQUIRE(loaded._eoi == built._eoi);
+	REQUIRE(loaded._features == built._features);
+	REQUIRE(loaded._dfa_alphabet == built._dfa_alphabet);
+
+	// Dereferenced ptr_vector is the vector of per-DFA tables.
+	const size_t dfaCount = (*built._dfa).size();
+	REQUIRE(dfaCount > 0);
+	REQUIRE((*built._lookup).size() == dfaCount);
+	REQUIRE((*loaded._lookup).size() == dfaCount);
+	REQUIRE((*loaded._dfa).size() == dfaCount);
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		REQUIRE(loaded._lookup[dfa] == built._lookup[dfa]);
+		REQUIRE(loaded._dfa[dfa] == built._dfa[dfa]);
+	}
+}
+
+TEST_CASE("Minimised state machine is not larger than unminimised", "[CalcLexer]") {
+	const MinimisationStats stats = GetCalcMinimisationStats();
+	REQUIRE(stats.after.stateCount > 0);
+	REQUIRE(stats.after.stateCount <= stats.before.stateCount);
+	REQUIRE(stats.after.tableSize <= stats.before.tableSize);
+
+	const StateMachineStats minimised = GetStateMachineStats(*GetCalcStateMachine(DfaMode::Minimised));
+	REQUIRE(minimised.stateCount == stats.after.stateCount);
+	REQUIRE(minimised.tableSize == stats.after.tableSize);
+
+	// Minimisation is opt-in, default DFA is the one from subset construction.
+	REQUIRE(GetCalcStateMachine() == GetCalcStateMachine(DfaMode::Unminimised));
+	REQUIRE(GetCalcStateMachine() != GetCalcStateMachine(DfaMode::Minimised));
+}
+
+TEST_CASE("Minimised and unminimised lexers read same tokens", "[CalcLexer]") {
+	for (const std::string& text : GetComparisonCorpus())
+	{
+		CalcLexer minimised{ text, DfaMode::Minimised };
+		CalcLexer unminimised{ text, DfaMode::Unminimised };
+		for (;;)
+		{
+			const Token expected = unminimised.Read();
+			const Token actual = minimised.Read();
+			REQUIRE(actual == expected);
+			REQUIRE(actual.offset == expected.offset);
+			if (expected.type == TT_END)
+			{
+				break;
+			}
+		}
+	}
+}
+
+TEST_CASE("Token refers to sources only when it has value", "[Token]") {
+	const std::string_view text = "x1 + 42";
+	const Token id = MakeToken(TT_ID, text.substr(0, 2), 0);
+	REQUIRE(id == Token{ TT_ID, "x1" });
+	REQUIRE(id.value->data() == text.data());
+	REQUIRE(id.offset == 0);
+
+	const Token plus = MakeToken(TT_PLUS, text.substr(3, 1), 3);
+	REQUIRE(plus == Token{ TT_PLUS });
+	REQUIRE(!plus.value);
+	REQUIRE(plus.offset == 3);
+
+	const Token number = MakeToken(TT_NUMBER, text.substr(5, 2), 5);
+	REQUIRE(number == Token{ TT_NUMBER, "42" });
+	REQUIRE(number.value->data() == text.data() + 5);
+	REQUIRE(number.offset == 5);
+
+	const OwnedToken owned{ number };
+	REQUIRE(owned.value == std::string("42"));
+	REQUIRE(owned.offset == 5);
+}
+
+TEST_CASE("Fast lexer reads same tokens as generic one", "[FastCalcLexer]") {
+	for (const std::string& text : GetComparisonCorpus())
+	{
+		CalcLexer generic{ text };
+		FastCalcLexer fast{ text };
+		for (;;)
+		{
+			const Token expected = generic.Read();
+			const Token actual = fast.Read();
+			REQUIRE(actual == expected);
+			REQUIRE(actual.offset == expected.offset);
+			if (expected.type == TT_END)
+			{
+				break;
+			}
+		}
+
+		TokenStream expectedStream;
+		TokenStream actualStream;
+		CalcLexer{ text }.ReadAll(expectedStream);
+		FastCalcLexer{ text }.ReadAll(actualStream);
+		REQUIRE(actualStream.GetTypes() == expectedStream.GetTypes());
+		REQUIRE(actualStream.GetOffsets() == expectedStream.GetOffsets());
+		REQUIRE(actualStream.GetLengths() == expectedStream.GetLengths());
+	}
+}
+
+TEST_CASE("Rule set adds custom operators and keywords", "[CalcRuleSet]") {
+	const auto TT_POWER = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const auto TT_PERCENT = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 1);
+	const auto TT_KEYWORD = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 2);
+
+	CalcRuleSet ruleSet;
+	ruleSet.AddRule("\\^", TT_POWER);
+	ruleSet.AddRule("%", TT_PERCENT);
+	ruleSet.AddRule("min|max", TT_KEYWORD);
+	ruleSet.WaitForRebuild();
+	REQUIRE(ruleSet.GetVersion() > 0);
+
+	CalcLexer lexer{ "max(a ^ 2) % minute", ruleSet };
+	REQUIRE(lexer.Read() == Token{ TT_KEYWORD, "max" });
+	REQUIRE(lexer.Read() == Token{ TT_OPEN_BRACKET });
+	REQUIRE(lexer.Read() == Token{ TT_ID, "a" });
+	REQUIRE(lexer.Read() == Token{ TT_POWER, "^" });
+	REQUIRE(lexer.Read() == Token{ TT_NUMBER, "2" });
+	REQUIRE(lexer.Read() == Token{ TT_CLOSE_BRACKET });
+	REQUIRE(lexer.Read() == Token{ TT_PERCENT, "%" });
+	REQUIRE(lexer.Read() == Token{ TT_ID, "minute" });
+	REQUIRE(lexer.Read() == Token{ TT_END });
+
+	TokenStream stream;
+	CalcLexer{ "2 ^ x", ruleSet }.ReadAll(stream);
+	REQUIRE(stream.Size() == 3);
+	REQUIRE(stream.GetType(1) == TT_POWER);
+}
+
+TEST_CASE("Rule set rejects invalid rules", "[CalcRuleSet]") {
+	CalcRuleSet ruleSet;
+	REQUIRE_THROWS_AS(ruleSet.AddRule("\\^", 0), std::invalid_argument);
+	REQUIRE_THROWS_AS(ruleSet.AddRule("\\^", FIRST_CUSTOM_TOKEN - 1), std::invalid_argument);
+	REQUIRE_THROWS_AS(ruleSet.AddRule("\\^", LAST_CUSTOM_TOKEN + 1), std::invalid_argument);
+	REQUIRE_THROWS_AS(ruleSet.AddRule("(", FIRST_CUSTOM_TOKEN), lexertl::runtime_error);
+	ruleSet.WaitForRebuild();
+	REQUIRE(ruleSet.GetVersion() == 0);
+}
+
+TEST_CASE("Rule set drops rule which fails to build", "[CalcRuleSet]") {
+	const auto TT_POWER = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const auto TT_PERCENT = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 1);
+	const auto TT_EMPTY = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 2);
+
+	// Rule matching empty string passes regex parsing but fails DFA build.
+	CalcRuleSet ruleSet;
+	ruleSet.AddRule("\\^", TT_POWER);
+	ruleSet.WaitForRebuild();
+	ruleSet.AddRule("x*", TT_EMPTY);
+	REQUIRE_THROWS_AS(ruleSet.WaitForRebuild(), lexertl::runtime_error);
+	const size_t version = ruleSet.GetVersion();
+
+	ruleSet.AddRule("%", TT_PERCENT);
+	ruleSet.WaitForRebuild();
+	REQUIRE(ruleSet.GetVersion() > version);
+
+	CalcLexer lexer{ "a ^ x % 2", ruleSet };
+	REQUIRE(lexer.Read() == Token{ TT_ID, "a" });
+	REQUIRE(lexer.Read() == Token{ TT_POWER, "^" });
+	REQUIRE(lexer.Read() == Token{ TT_ID, "x" });
+	REQUIRE(lexer.Read() == Token{ TT_PERCENT, "%" });
+	REQUIRE(lexer.Read() == Token{ TT_NUMBER, "2" });
+	REQUIRE(lexer.Read() == Token{ TT_END });
+}
+
+TEST_CASE("Rule set keeps good rules built together with bad one", "[CalcRuleSet]") {
+	const auto TT_PERCENT = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const auto TT_EMPTY = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 1);
+
+	CalcRuleSet ruleSet;
+	ruleSet.AddRule("x?", TT_EMPTY);
+	ruleSet.AddRule("%", TT_PERCENT);
+	// Rules may be built in one or two rebuilds, so error is reported only in the first case.
+	try
+	{
+		ruleSet.WaitForRebuild();
+	}
+	catch (const lexertl::runtime_error&)
+	{
+	}
+
+	CalcLexer lexer{ "x % 2", ruleSet };
+	REQUIRE(lexer.Read() == Token{ TT_ID, "x" });
+	REQUIRE(lexer.Read() == Token{ TT_PERCENT, "%" });
+	REQUIRE(lexer.Read() == Token{ TT_NUMBER, "2" });
+	REQUIRE(lexer.Read() == Token{ TT_END });
+}
+
+TEST_CASE("Live lexer switches to rebuilt state machine", "[CalcRuleSet]") {
+	const auto TT_POWER = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const std::string text = "a ^ b ^ c";
+
+	CalcRuleSet ruleSet;
+	CalcLexer live{ text, ruleSet };
+	CalcLexer snapshot{ text, ruleSet.GetStateMachine() };
+	REQUIRE(live.Read() == Token{ TT_ID, "a" });
+	REQUIRE(live.Read() == Token{ TT_ERROR, "^" });
+	REQUIRE(snapshot.Read() == Token{ TT_ID, "a" });
+
+	ruleSet.AddRule("\\^", TT_POWER);
+	ruleSet.WaitForRebuild();
+
+	const Token b = live.Read();
+	REQUIRE(b == Token{ TT_ID, "b" });
+	REQUIRE(b.offset == 4);
+	REQUIRE(live.Read() == Token{ TT_POWER, "^" });
+	REQUIRE(live.Read() == Token{ TT_ID, "c" });
+	REQUIRE(live.Read() == Token{ TT_END });
+
+	REQUIRE(snapshot.Read() == Token{ TT_ERROR, "^" });
+}
+
+TEST_CASE("Lexer reclassifies ids found in keyword table", "[KeywordTable]") {
+	const auto TT_MIN = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	const auto TT_MAX = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 1);
+	const auto TT_PI = static_cast<TokenType>(FIRST_CUSTOM_TOKEN + 2);
+	const KeywordTable keywords{ { { "min", TT_MIN }, { "max", TT_MAX }, { "pi", TT_PI } } };
+	REQUIRE(keywords.Size() == 3);
+
+	CalcLexer lexer{ "max(min) + minute * pi" };
+	lexer.SetKeywords(keywords);
+	REQUIRE(lexer.Read() == Token{ TT_MAX, "max" });
+	REQUIRE(lexer.Read() == Token{ TT_OPEN_BRACKET });
+	REQUIRE(lexer.Read() == Token{ TT_MIN, "min" });
+	REQUIRE(lexer.Read() == Token{ TT_CLOSE_BRACKET });
+	REQUIRE(lexer.Read() == Token{ TT_PLUS });
+	REQUIRE(lexer.Read() == Token{ TT_ID, "minute" });
+	REQUIRE(lexer.Read() == Token{ TT_ASTERISK });
+	REQUIRE(lexer.Read() == Token{ TT_PI, "pi" });
+	REQUIRE(lexer.Read() == Token{ TT_END });
+
+	TokenStream stream;
+	CalcLexer streamLexer{ "pi * p" };
+	streamLexer.SetKeywords(keywords);
+	streamLexer.ReadAll(stream);
+	REQUIRE(stream.Size() == 3);
+	REQUIRE(stream.GetType(0) == TT_PI);
+	REQUIRE(stream.GetType(2) == TT_ID);
+}
+
+TEST_CASE("Keyword table finds every keyword of large set", "[KeywordTable]") {
+	std::vector<Keyword> keywords;
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		keywords.push_back(Keyword{ "kw" + std::to_string(i), static_cast<TokenType>(FIRST_CUSTOM_TOKEN + i % 100) });
+	}
+	const KeywordTable table{ keywords };
+	REQUIRE(table.Size() == keywords.size());
+	for (const Keyword& keyword : keywords)
+	{
+		REQUIRE(table.Find(keyword.text) == keyword.type);
+	}
+	REQUIRE(table.Find("kw") == TT_ID);
+	REQUIRE(table.Find("kw5000") == TT_ID);
+	REQUIRE(table.Find("kw00") == TT_ID);
+	REQUIRE(table.Find("") == TT_ID);
+	REQUIRE(KeywordTable{}.Find("kw1") == TT_ID);
+}
+
+TEST_CASE("Keyword table rejects invalid keywords", "[KeywordTable]") {
+	const auto TT_MIN = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min", TT_MIN }, { "min", TT_MIN } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "", TT_MIN } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min", TT_ID } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "2pi", TT_MIN } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "a.b", TT_MIN } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min-max", TT_MIN } }), std::invalid_argument);
+	REQUIRE_THROWS_AS(KeywordTable({ { "min ", TT_MIN } }), std::invalid_argument);
+	REQUIRE(KeywordTable({ { "_min2", TT_MIN } }).Find("_min2") == TT_MIN);
+}
+
+TEST_CASE("Lexer can be reset to new sources", "[CalcLexer]") {
+	const StateMachinePtr stateMachine = BuildCalcStateMachine();
+	CalcLexer lexer{ "a + b", stateMachine };
+	REQUIRE(lexer.Read() == Token{ TT_ID, "a" });
+
+	lexer.Reset("x = 2");
+	REQUIRE(&lexer.GetStateMachine() == stateMachine.get());
+	REQUIRE(lexer.Read() == Token{ TT_ID, "x" });
+	REQUIRE(lexer.Read() == Token{ TT_EQUAL });
+	const Token number = lexer.Read();
+	REQUIRE(number == Token{ TT_NUMBER, "2" });
+	REQUIRE(number.offset == 4);
+	REQUIRE(lexer.Read() == Token{ TT_END });
+
+	lexer.Reset("");
+	REQUIRE(lexer.Read() == Token{ TT_END });
+
+	FastCalcLexer fast{ "a" };
+	fast.Reset("(1)");
+	TokenStream stream;
+	fast.ReadAll(stream);
+	REQUIRE(stream.Size() == 3);
+	REQUIRE(stream.GetType(1) == TT_NUMBER);
+}
+
+TEST_CASE("Reset lexer switches to latest rule set state machine", "[CalcRuleSet]") {
+	const auto TT_POWER = static_cast<TokenType>(FIRST_CUSTOM_TOKEN);
+	CalcRuleSet ruleSet;
+	CalcLexer lexer{ "a", ruleSet };
+	REQUIRE(lexer.Read() == Token{ TT_ID, "a" });
+
+	ruleSet.AddRule("\\^", TT_POWER);
+	ruleSet.WaitForRebuild();
+	lexer.Reset("^");
+	REQUIRE(&lexer.GetStateMachine() == ruleSet.GetStateMachine().get());
+	REQUIRE(lexer.Read() == Token{ TT_POWER, "^" });
+}
@@ -0,0 +1,700 @@
+#include <catch2/catch.hpp>
+#include "../lexertl-based-scanner/DfaCache.h"
+#include "../lexertl-based-scanner/FileScanner.h"
+#include "../lexertl-based-scanner/InputReader.h"
+#include "../lexertl-based-scanner/OrderedOutput.h"
+#include "../lexertl-based-scanner/RuleSpec.h"
+#include "../lexertl-based-scanner/ScanStats.h"
+#include "../lexertl-based-scanner/TokenWriter.h"
+#include "lexertl/generator.hpp"
+#include "lexertl/iterator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+const char CALC_SPEC[] =
+	"# calc\n"
+	"macro DIGIT [0-9]\n"
+	"token 1 {DIGIT}+\n"
+	"token 2 [a-z]+\n"
+	"token 3 \\+\n"
+	"skip [ \\t\\r\\n]+\n";
+
+// Каталог во временном каталоге, удаляемый вместе с содержимым.
+struct TempDir
+{
+	TempDir()
+		: path(fs::temp_directory_path() / ("scanner-tests-" + std::to_string(std::random_device()())))
+	{
+		fs::create_directories(path);
+	}
+
+	~TempDir()
+	{
+		std::error_code error;
+		fs::remove_all(path, error);
+	}
+
+	fs::path path;
+};
+
+void WriteFile(const fs::path &path, const std::string &text)
+{
+	std::ofstream(path, std::ios::binary) << text;
+}
+
+std::vector<size_t> LexIds(const lexertl::state_machine &lexer, const std::string &text)
+{
+	std::vector<size_t> ids;
+	lexertl::citerator iter(text.data(), text.data() + text.size(), lexer);
+	for (lexertl::citerator end; iter != end; ++iter)
+	{
+		ids.push_back(iter->id);
+	}
+	return ids;
+}
+
+std::vector<fs::path> ListCacheFiles(const fs::path &dir)
+{
+	std::vector<fs::path> files;
+	for (const auto &entry : fs::directory_iterator(dir))
+	{
+		files.push_back(entry.path());
+	}
+	return files;
+}
+
+uint64_t GetCacheKey(const fs::path &cacheFile)
+{
+	return std::stoull(cacheFile.stem().string(), nullptr, 16);
+}
+
+std::unique_ptr<lexertl::state_machine> BuildSpecLexer(const std::string &spec)
+{
+	auto lexer = std::make_unique<lexertl::state_machine>();
+	lexertl::generator::build(ParseRuleSpec(spec), *lexer);
+	return lexer;
+}
+
+// Токен, как его получает обработчик ScanRange.
+struct ScannedToken
+{
+	size_t id = 0;
+	size_t offset = 0;
+	std::string text;
+
+	bool operator==(const ScannedToken &other) const
+	{
+		return id == other.id && offset == other.offset && text == other.text;
+	}
+};
+
+struct TokenCollector
+{
+	void operator()(const lexertl::cmatch &token, size_t offset)
+	{
+		tokens.push_back({ token.id, offset, token.str() });
+	}
+
+	std::vector<ScannedToken> tokens;
+};
+
+std::vector<ScannedToken> ScanWholeText(const lexertl::state_machine &lexer, const std::string &text)
+{
+	TokenCollector collector;
+	ScanRange(lexer, text.data(), text.data() + text.size(), 0, collector);
+	return collector.tokens;
+}
+
+std::vector<ScannedToken> ScanAsStream(const lexertl::state_machine &lexer, const fs::path &path)
+{
+	TokenCollector collector;
+	std::FILE *input = std::fopen(path.string().c_str(), "rb");
+	REQUIRE(input != nullptr);
+	const bool ok = ScanStream(lexer, input, collector);
+	std::fclose(input);
+	REQUIRE(ok);
+	return collector.tokens;
+}
+
+// Пишет через TokenWriter всё, что выводит `write`, и возвращает вывод.
+template <class Write>
+std::string WriteTokens(OutputFormat format, Write &&write)
+{
+	std::string output;
+	{
+		TokenWriter writer(format, [&output](const char *data, size_t size) {
+			output.append(data, size);
+			return true;
+		});
+		write(writer);
+	}
+	return output;
+}
+
+// Так писал токены сканер до TokenWriter: по строкам через std::getline и std::ostream.
+std::string WriteTokensLikeLineScanner(const lexertl::state_machine &lexer, const std::string &text)
+{
+	std::istringstream input(text);
+	std::ostringstream output;
+	while (input)
+	{
+		std::string line;
+		std::getline(input, line);
+		lexertl::siterator iter(line.begin(), line.end(), lexer);
+		for (lexertl::siterator end; iter != end; ++iter)
+		{
+			output << "Id: " << iter->id << ", Token: '" << iter->str() << "'\n";
+		}
+	}
+	return output.str();
+}
+
+void AppendBinaryRecord(std::string &out, uint32_t id, uint32_t length, uint64_t offset)
+{
+	out.append(reinterpret_cast<const char *>(&id), sizeof(id));
+	out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+	out.append(reinterpret_cast<const char *>(&offset), sizeof(offset));
+}
+
+// Файл вывода во временном каталоге, открытый на запись и чтение.
+struct OutputFile
+{
+	OutputFile()
+		: file(std::fopen((temp.path / "output").string().c_str(), "w+b"))
+	{
+		REQUIRE(file != nullptr);
+	}
+
+	~OutputFile()
+	{
+		std::fclose(file);
+	}
+
+	std::string Read()
+	{
+		std::fflush(file);
+		std::rewind(file);
+		std::string text;
+		char chunk[4096];
+		for (size_t size; (size = std::fread(chunk, 1, sizeof(chunk), file)) != 0;)
+		{
+			text.append(chunk, size);
+		}
+		return text;
+	}
+
+	TempDir temp;
+	std::FILE *file;
+};
+
+// Запускает `action` в отдельном потоке и проверяет, что он ждёт,
+//  пока `release` не даст ему продолжить. Оба должны вернуть true.
+// Проверки Catch не потокобезопасны, поэтому все они делаются в вызывающем потоке.
+template <class Action, class Release>
+void RequireBlockedUntil(Action &&action, Release &&release)
+{
+	std::atomic<bool> finished{ false };
+	bool result = false;
+	std::thread thread([&] {
+		result = action();
+		finished = true;
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	const bool finishedEarly = finished;
+	const bool released = release();
+	thread.join();
+	REQUIRE_FALSE(finishedEarly);
+	REQUIRE(released);
+	REQUIRE(result);
+}
+
+// Вывод ScanFiles, полученный без потоков: заголовок и токены каждого файла подряд.
+std::string ScanFilesSequentially(const lexertl::state_machine &lexer,
+	const std::vector<std::string> &files, OutputFormat format)
+{
+	return WriteTokens(format, [&](TokenWriter &writer) {
+		auto writeToken = [&writer](const lexertl::cmatch &token, size_t offset) {
+			writer.Write(token.id, token.first, static_cast<size_t>(token.second - token.first), offset);
+		};
+		for (const std::string &path : files)
+		{
+			writer.WriteFileStart(path);
+			REQUIRE(ScanFile(lexer, path.c_str(), writeToken));
+		}
+	});
+}
+
+std::vector<ScannedToken> ScanAsFile(const lexertl::state_machine &lexer, const fs::path &path)
+{
+	TokenCollector collector;
+	REQUIRE(ScanFile(lexer, path.string().c_str(), collector));
+	return collector.tokens;
+}
+}
+
+TEST_CASE("Rule spec builds lexer with macros and skip rules", "[RuleSpec]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	REQUIRE(LexIds(*lexer, "ab + 12\n+x") == std::vector<size_t>{ 2, 3, 1, 3, 2 });
+	REQUIRE(LexIds(*lexer, "a*") == std::vector<size_t>{ 2, lexertl::cmatch::npos() });
+}
+
+TEST_CASE("Rule spec ignores trailing whitespace of lines", "[RuleSpec]") {
+	const auto lexer = BuildSpecLexer("token 1 a+ \t\r\ntoken 2 b[ ]\t\nskip [ ]+  \n  \t\n");
+	REQUIRE(LexIds(*lexer, "aa a") == std::vector<size_t>{ 1, 1 });
+	REQUIRE(LexIds(*lexer, "b a") == std::vector<size_t>{ 2, 1 });
+	REQUIRE_THROWS_WITH(ParseRuleSpec("token 1  \t\r\n"), "Rules line 1: expected 'token <id> <regex>'");
+}
+
+TEST_CASE("Rule spec errors name the line", "[RuleSpec]") {
+	REQUIRE_THROWS_WITH(ParseRuleSpec("token 1 a\ntoken 0 b\n"), "Rules line 2: token id must be a number from 1 to 65535");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("token 65536 a\n"), "Rules line 1: token id must be a number from 1 to 65535");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("token x1 a\n"), "Rules line 1: token id must be a number from 1 to 65535");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("# comment\ntokn 1 a\n"), "Rules line 2: unknown directive 'tokn'");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("macro D\n"), "Rules line 1: expected 'macro <name> <regex>'");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("token 1\n"), "Rules line 1: expected 'token <id> <regex>'");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("skip\n"), "Rules line 1: expected 'skip <regex>'");
+	REQUIRE_THROWS_WITH(ParseRuleSpec("skip \\s+\n"), "Rules contain no tokens");
+	// Ошибки в самих regex находит lexertl при построении DFA.
+	REQUIRE_THROWS_AS(BuildSpecLexer("token 1 [a\n"), std::runtime_error);
+	REQUIRE_THROWS_AS(BuildSpecLexer("token 1 {X}+\n"), std::runtime_error);
+}
+
+TEST_CASE("Rule spec lexer is cached on miss and loaded on hit", "[DfaCache]") {
+	TempDir temp;
+	const fs::path specPath = temp.path / "calc.rules";
+	const fs::path cacheDir = temp.path / "cache";
+	WriteFile(specPath, CALC_SPEC);
+
+	const auto built = LoadRuleSpecLexer(specPath.string(), cacheDir.string());
+	REQUIRE(LexIds(*built, "a + 1") == std::vector<size_t>{ 2, 3, 1 });
+	const std::vector<fs::path> cacheFiles = ListCacheFiles(cacheDir);
+	REQUIRE(cacheFiles.size() == 1);
+	REQUIRE(cacheFiles[0].extension() == ".dfa");
+
+	/*
+	 * Подменяем закешированный DFA другим, правильным DFA с тем же ключом:
+	 *  если сканер прочтёт кеш, он будет разбирать по подменённым правилам.
+	 */
+	const auto other = BuildSpecLexer("token 7 [a-z0-9]+\nskip [ +]+\n");
+	REQUIRE(SaveStateMachine(*other, GetCacheKey(cacheFiles[0]), cacheFiles[0].string()));
+	const auto cached = LoadRuleSpecLexer(specPath.string(), cacheDir.string());
+	REQUIRE(LexIds(*cached, "a + 1") == std::vector<size_t>{ 7, 7 });
+
+	// Другой текст правил - другой ключ, то есть промах и новый файл.
+	WriteFile(specPath, std::string(CALC_SPEC) + "token 4 \\-\n");
+	const auto changed = LoadRuleSpecLexer(specPath.string(), cacheDir.string());
+	REQUIRE(LexIds(*changed, "a - 1") == std::vector<size_t>{ 2, 4, 1 });
+	REQUIRE(ListCacheFiles(cacheDir).size() == 2);
+}
+
+TEST_CASE("Corrupt or out of range cache files are rejected", "[DfaCache]") {
+	TempDir temp;
+	const std::string path = (temp.path / "lexer.dfa").string();
+	const uint64_t key = 42;
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	lexertl::state_machine loaded;
+
+	REQUIRE(SaveStateMachine(*lexer, key, path));
+	REQUIRE(LoadStateMachine(path, key, loaded));
+	REQUIRE(LexIds(loaded, "a + 1") == std::vector<size_t>{ 2, 3, 1 });
+	REQUIRE_FALSE(LoadStateMachine(path, key + 1, loaded));
+	REQUIRE_FALSE(LoadStateMachine((temp.path / "missing.dfa").string(), key, loaded));
+
+	SECTION("damaged bytes fail checksum")
+	{
+		std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+		file.seekp(-1, std::ios::end);
+		file.put('\x7F');
+		file.close();
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+
+	SECTION("truncated file")
+	{
+		fs::resize_file(path, fs::file_size(path) - 8);
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+
+	/*
+	 * Следующие файлы записаны с верной контрольной суммой,
+	 *  как их мог бы подложить другой пользователь.
+	 */
+	auto &internals = lexer->data();
+	SECTION("lookup entry beyond alphabet")
+	{
+		internals._lookup[0]['a'] = 1000000000;
+		REQUIRE(SaveStateMachine(*lexer, key, path));
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+
+	SECTION("transition to missing state")
+	{
+		const size_t stateCount = internals._dfa[0].size() / internals._dfa_alphabet[0];
+		internals._dfa[0][internals._dfa_alphabet[0] + lexertl::transitions_index] = stateCount;
+		REQUIRE(SaveStateMachine(*lexer, key, path));
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+
+	SECTION("table is not made of whole rows")
+	{
+		internals._dfa[0].push_back(0);
+		REQUIRE(SaveStateMachine(*lexer, key, path));
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+
+	SECTION("token id beyond spec range")
+	{
+		auto &table = internals._dfa[0];
+		const size_t alphabet = internals._dfa_alphabet[0];
+		for (size_t row = alphabet; row < table.size(); row += alphabet)
+		{
+			if (table[row + lexertl::end_state_index] != 0)
+			{
+				table[row + lexertl::id_index] = MAX_RULE_TOKEN_ID + 1;
+			}
+		}
+		REQUIRE(SaveStateMachine(*lexer, key, path));
+		REQUIRE_FALSE(LoadStateMachine(path, key, loaded));
+	}
+}
+
+TEST_CASE("Rejected cache file is rebuilt", "[DfaCache]") {
+	TempDir temp;
+	const fs::path specPath = temp.path / "calc.rules";
+	const fs::path cacheDir = temp.path / "cache";
+	WriteFile(specPath, CALC_SPEC);
+	LoadRuleSpecLexer(specPath.string(), cacheDir.string());
+	const fs::path cacheFile = ListCacheFiles(cacheDir).at(0);
+
+	auto planted = BuildSpecLexer(CALC_SPEC);
+	planted->data()._lookup[0]['a'] = 1000000000;
+	REQUIRE(SaveStateMachine(*planted, GetCacheKey(cacheFile), cacheFile.string()));
+
+	const auto lexer = LoadRuleSpecLexer(specPath.string(), cacheDir.string());
+	REQUIRE(LexIds(*lexer, "a + 1") == std::vector<size_t>{ 2, 3, 1 });
+	lexertl::state_machine loaded;
+	REQUIRE(LoadStateMachine(cacheFile.string(), GetCacheKey(cacheFile), loaded));
+}
+
+#ifndef _WIN32
+TEST_CASE("Cache directory is private to its owner", "[DfaCache]") {
+	TempDir temp;
+	const fs::path specPath = temp.path / "calc.rules";
+	WriteFile(specPath, CALC_SPEC);
+
+	const fs::path privateDir = temp.path / "private";
+	LoadRuleSpecLexer(specPath.string(), privateDir.string());
+	struct stat info;
+	REQUIRE(stat(privateDir.c_str(), &info) == 0);
+	REQUIRE((info.st_mode & 0777) == 0700);
+	REQUIRE(ListCacheFiles(privateDir).size() == 1);
+
+	// В каталог, куда могут писать другие, кеш не пишется и оттуда не читается.
+	const fs::path sharedDir = temp.path / "shared";
+	fs::create_directories(sharedDir);
+	fs::permissions(sharedDir, fs::perms::all);
+	const auto lexer = LoadRuleSpecLexer(specPath.string(), sharedDir.string());
+	REQUIRE(LexIds(*lexer, "a + 1") == std::vector<size_t>{ 2, 3, 1 });
+	REQUIRE(ListCacheFiles(sharedDir).empty());
+}
+#endif
+
+TEST_CASE("Stream and mapped file give same tokens as whole buffer", "[InputReader]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	std::string text;
+	// Токен, ради которого написан раздел: без него сравнение ничего не проверяет.
+	std::vector<ScannedToken> required;
+
+	SECTION("token straddles block boundary")
+	{
+		// Строки по 8 байт, число из следующей строки пересекает границу первого блока.
+		while (text.size() < INPUT_BLOCK_SIZE - 8)
+		{
+			text += "ab + 12\n";
+		}
+		text += "xyz 1234567890\n+ 5\n";
+		required.push_back({ 1, INPUT_BLOCK_SIZE - 4, "1234567890" });
+	}
+
+	SECTION("line longer than block")
+	{
+		text = "a\n";
+		while (text.size() < 2 * INPUT_BLOCK_SIZE + INPUT_BLOCK_SIZE / 2)
+		{
+			text += "ab+1 ";
+		}
+		text += "\nz\n";
+		required.push_back({ 2, text.size() - 2, "z" });
+	}
+
+	SECTION("no trailing newline")
+	{
+		text = "ab + 12\nxy - 3";
+		required.push_back({ lexertl::cmatch::npos(), 11, "-" });
+		required.push_back({ 1, 13, "3" });
+	}
+
+	SECTION("empty input")
+	{
+	}
+
+	TempDir temp;
+	const fs::path path = temp.path / "input.txt";
+	WriteFile(path, text);
+	const std::vector<ScannedToken> expected = ScanWholeText(*lexer, text);
+	for (const ScannedToken &token : required)
+	{
+		REQUIRE(std::find(expected.begin(), expected.end(), token) != expected.end());
+	}
+	REQUIRE(ScanAsStream(*lexer, path) == expected);
+	REQUIRE(ScanAsFile(*lexer, path) == expected);
+}
+
+TEST_CASE("Text output matches line by line scanner", "[TokenWriter]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	const std::string text = "ab + 12\n(x)*3\n\n\tlast+1";
+	const std::string output = WriteTokens(OutputFormat::Text, [&](TokenWriter &writer) {
+		auto writeToken = [&writer](const lexertl::cmatch &token, size_t offset) {
+			writer.Write(token.id, token.first, static_cast<size_t>(token.second - token.first), offset);
+		};
+		ScanRange(*lexer, text.data(), text.data() + text.size(), 0, writeToken);
+	});
+	REQUIRE(output == WriteTokensLikeLineScanner(*lexer, text));
+	const std::string head = "Id: 2, Token: 'ab'\nId: 3, Token: '+'\nId: 1, Token: '12'\n"
+		"Id: " + std::to_string(lexertl::cmatch::npos()) + ", Token: '('\n";
+	REQUIRE(output.compare(0, head.size(), head) == 0);
+
+	const std::string withFile = WriteTokens(OutputFormat::Text, [](TokenWriter &writer) {
+		writer.WriteFileStart("dir/a.txt");
+		writer.Write(1, "7", 1, 0);
+	});
+	REQUIRE(withFile == "File: dir/a.txt\nId: 1, Token: '7'\n");
+}
+
+TEST_CASE("Binary output is made of fixed records", "[TokenWriter]") {
+	const std::string output = WriteTokens(OutputFormat::Binary, [](TokenWriter &writer) {
+		writer.WriteFileStart("a.txt");
+		writer.Write(2, "ab", 2, 5);
+		writer.Write(lexertl::cmatch::npos(), "#", 1, 0x100000000ull);
+	});
+	std::string expected;
+	AppendBinaryRecord(expected, BINARY_FILE_RECORD_ID, 5, 0);
+	expected += "a.txt";
+	AppendBinaryRecord(expected, 2, 2, 5);
+	AppendBinaryRecord(expected, UINT32_MAX, 1, 0x100000000ull);
+	REQUIRE(output.size() == 3 * sizeof(BinaryTokenRecord) + 5);
+	REQUIRE(output == expected);
+}
+
+TEST_CASE("NDJSON output escapes token text", "[TokenWriter]") {
+	const std::string text = "q\"b\\n\nt\t\x01\x1F~\x7F\xC3\xA9";
+	const std::string output = WriteTokens(OutputFormat::NdJson, [&](TokenWriter &writer) {
+		writer.WriteFileStart("dir\\\"a\".txt");
+		writer.Write(3, text.data(), text.size(), 12);
+		writer.Write(lexertl::cmatch::npos(), "#", 1, 40);
+	});
+	REQUIRE(output ==
+		"{\"file\":\"dir\\\\\\\"a\\\".txt\"}\n"
+		"{\"id\":3,\"offset\":12,\"length\":14,"
+		"\"text\":\"q\\\"b\\\\n\\u000at\\u0009\\u0001\\u001f~\\u007f\\u00c3\\u00a9\"}\n"
+		"{\"id\":-1,\"offset\":40,\"length\":1,\"text\":\"#\"}\n");
+}
+
+TEST_CASE("Ordered output writes files in list order whatever order they finish in", "[OrderedOutput]") {
+	OutputFile output;
+	const std::vector<std::string> files = { "a", "b", "c" };
+	OrderedOutput ordered(output.file, files, 3, 1024);
+	size_t index = 0;
+	for (size_t expected = 0; expected < files.size(); ++expected)
+	{
+		REQUIRE(ordered.TakeNextFile(index));
+		REQUIRE(index == expected);
+	}
+	REQUIRE_FALSE(ordered.TakeNextFile(index));
+
+	REQUIRE(ordered.Write(2, "c1", 2));
+	REQUIRE(ordered.Write(1, "b1", 2));
+	REQUIRE(ordered.Write(2, "c2", 2));
+	ordered.FinishFile(2, true);
+	REQUIRE(output.Read().empty());
+
+	// Вывод головного файла пишется сразу, ничего не дожидаясь.
+	REQUIRE(ordered.Write(0, "a1", 2));
+	REQUIRE(output.Read() == "a1");
+	REQUIRE(ordered.Write(1, "b2", 2));
+	ordered.FinishFile(1, true);
+	REQUIRE(output.Read() == "a1");
+
+	REQUIRE(ordered.Write(0, "a2", 2));
+	ordered.FinishFile(0, true);
+	REQUIRE(output.Read() == "a1a2b1b2c1c2");
+	REQUIRE(ordered.IsOk());
+}
+
+TEST_CASE("Ordered output limits files in flight", "[OrderedOutput]") {
+	OutputFile output;
+	const std::vector<std::string> files = { "a", "b", "c", "d" };
+	OrderedOutput ordered(output.file, files, 2, 1024);
+	size_t first = 0;
+	size_t second = 0;
+	REQUIRE(ordered.TakeNextFile(first));
+	REQUIRE(ordered.TakeNextFile(second));
+
+	// Законченный неголовной файл не освобождает место, только головной.
+	ordered.FinishFile(second, true);
+	size_t third = 0;
+	RequireBlockedUntil([&] { return ordered.TakeNextFile(third); }, [&] {
+		ordered.FinishFile(first, true);
+		return true;
+	});
+	REQUIRE(third == 2);
+}
+
+TEST_CASE("Ordered output blocks writers over buffered byte limit", "[OrderedOutput]") {
+	OutputFile output;
+	const std::vector<std::string> files = { "a", "b", "c" };
+	OrderedOutput ordered(output.file, files, 3, 4);
+	size_t index = 0;
+	REQUIRE(ordered.TakeNextFile(index));
+	REQUIRE(ordered.TakeNextFile(index));
+	REQUIRE(ordered.TakeNextFile(index));
+
+	// Головной файл пишет сразу, сколько бы байт ни было.
+	REQUIRE(ordered.Write(0, "a123456", 7));
+	REQUIRE(ordered.Write(1, "b1", 2));
+	REQUIRE(ordered.Write(2, "c1", 2));
+
+	// Файл c ждёт, пока b не станет головным и не запишет накопленный вывод.
+	RequireBlockedUntil([&] { return ordered.Write(2, "c2", 2); }, [&] {
+		ordered.FinishFile(0, true);
+		return ordered.Write(1, "b2345", 5);
+	});
+	REQUIRE(output.Read() == "a123456b1b2345");
+
+	// Кусок, который не помещается в предел, ждёт очереди своего файла.
+	RequireBlockedUntil([&] { return ordered.Write(2, "c3456", 5); }, [&] {
+		ordered.FinishFile(1, true);
+		return true;
+	});
+	ordered.FinishFile(2, true);
+	REQUIRE(output.Read() == "a123456b1b2345c1c2c3456");
+	REQUIRE(ordered.IsOk());
+}
+
+TEST_CASE("Many files give same output with one and many threads", "[FileScanner]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	TempDir temp;
+	std::vector<std::string> files;
+	for (size_t i = 0; i < 40; ++i)
+	{
+		// Файлы разного размера, в том числе пустой и больше буфера вывода.
+		std::string text;
+		const size_t lines = (i == 0) ? 0 : (i % 7 == 0 ? 50000 : i * 13);
+		for (size_t line = 0; line < lines; ++line)
+		{
+			text += "x" + std::to_string(i) + " + " + std::to_string(line) + " # y\n";
+		}
+		const fs::path path = temp.path / ("input" + std::to_string(i) + ".txt");
+		WriteFile(path, text);
+		files.push_back(path.string());
+	}
+
+	for (const OutputFormat format : { OutputFormat::Text, OutputFormat::Binary, OutputFormat::NdJson })
+	{
+		const std::string expected = ScanFilesSequentially(*lexer, files, format);
+		for (const size_t threadCount : { 1, 8 })
+		{
+			OutputFile output;
+			REQUIRE(ScanFiles(*lexer, files, format, output.file, threadCount));
+			REQUIRE(output.Read() == expected);
+		}
+	}
+}
+
+TEST_CASE("Unreadable file fails scan without its output", "[FileScanner]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	TempDir temp;
+	const std::string first = (temp.path / "a.txt").string();
+	const std::string missing = (temp.path / "missing.txt").string();
+	const std::string last = (temp.path / "b.txt").string();
+	WriteFile(first, "a + 1\n");
+	WriteFile(last, "b\n");
+
+	// По false из ScanFiles сканер завершается с кодом 1.
+	OutputFile output;
+	REQUIRE_FALSE(ScanFiles(*lexer, { first, missing, last }, OutputFormat::Text, output.file, 2));
+	REQUIRE(output.Read() == ScanFilesSequentially(*lexer, { first, last }, OutputFormat::Text));
+}
+
+TEST_CASE("Profiling handler counts tokens and input and passes tokens on", "[ScanStats]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	const std::string text = "ab + 12\nx+1 # 7\n\nzz";
+	ScanStats stats;
+	TokenCollector collector;
+	{
+		ProfilingHandler<TokenCollector> handler(stats, collector);
+		ScanRange(*lexer, text.data(), text.data() + text.size(), 0, handler);
+	}
+	REQUIRE(collector.tokens == ScanWholeText(*lexer, text));
+
+	std::ostringstream report;
+	stats.Print(report, 0);
+	const std::string output = report.str();
+	REQUIRE(output.substr(0, output.find('\n')) == "Input: 19 bytes, 4 lines, 9 tokens");
+	// Таблица токенов идёт последней, время и пропускная способность не проверяются.
+	const size_t tableStart = output.find("\nId ");
+	REQUIRE(tableStart != std::string::npos);
+	REQUIRE(output.substr(tableStart + 1) ==
+		"Id         Tokens        Bytes\n"
+		"-1              1            1\n"
+		"1               3            4\n"
+		"2               3            5\n"
+		"3               2            2\n");
+}
+
+TEST_CASE("Profiling handler passes on every batch and merged stats add up", "[ScanStats]") {
+	const auto lexer = BuildSpecLexer(CALC_SPEC);
+	// Больше токенов, чем в одной пачке обработчика.
+	std::string text;
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		text += "a+1\n";
+	}
+	ScanStats total;
+	TokenCollector collector;
+	for (const size_t part : { 0, 1 })
+	{
+		ScanStats stats;
+		ProfilingHandler<TokenCollector> handler(stats, collector);
+		ScanRange(*lexer, text.data(), text.data() + text.size(), part * text.size(), handler);
+		total.Merge(stats);
+	}
+	REQUIRE(collector.tokens.size() == 2 * 3 * 5000);
+	REQUIRE(collector.tokens.back().offset == 2 * text.size() - 2);
+
+	std::ostringstream report;
+	total.Print(report, 0);
+	const std::string output = report.str();
+	REQUIRE(output.substr(0, output.find('\n')) == "Input: 40000 bytes, 10000 lines, 30000 tokens");
+	REQUIRE(output.substr(output.find("\nId ") + 1) ==
+		"Id         Tokens        Bytes\n"
+		"1           10000        10000\n"
+		"2           10000        10000\n"
+		"3           10000        10000\n");
+}
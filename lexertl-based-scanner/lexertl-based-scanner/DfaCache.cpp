@@ -0,0 +1,388 @@
+#include "DfaCache.h"
+#include "RuleSpec.h"
+#include "lexertl/generator.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+namespace fs = std::filesystem;
+
+// Сигнатура и версия формата файла кеша.
+// При изменении формата нужно сменить версию, чтобы старые файлы не читались.
+const char CACHE_MAGIC[8] = { 'L', 'X', 'D', 'F', 'A', '0', '0', '1' };
+
+// Заголовок файла кеша, за ним следует тело из `bodySize` чисел uint64_t:
+//   eoi, features, число DFA, затем для каждого DFA
+//   размер алфавита, размер таблицы, 256 чисел lookup и таблица переходов.
+struct CacheHeader
+{
+	char magic[8];
+	uint64_t key;
+	uint64_t checksum; // FNV-1a от байт тела
+	uint64_t bodySize;
+};
+
+// FNV-1a, 64 бита.
+uint64_t HashBytes(const void *data, size_t size)
+{
+	const auto *bytes = static_cast<const unsigned char *>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Читает числа тела кеша по порядку с проверкой границ.
+class BodyReader
+{
+public:
+	explicit BodyReader(const std::vector<uint64_t> &body)
+		: m_body(body)
+	{
+	}
+
+	bool Read(uint64_t &value)
+	{
+		if (m_pos == m_body.size())
+		{
+			return false;
+		}
+		value = m_body[m_pos++];
+		return true;
+	}
+
+	bool Read(std::vector<size_t> &values, uint64_t count)
+	{
+		if (count > m_body.size() - m_pos)
+		{
+			return false;
+		}
+		values.assign(m_body.begin() + m_pos, m_body.begin() + m_pos + count);
+		m_pos += count;
+		return true;
+	}
+
+	bool AtEnd() const
+	{
+		return m_pos == m_body.size();
+	}
+
+private:
+	const std::vector<uint64_t> &m_body;
+	size_t m_pos = 0;
+};
+
+// Проверяет, что таблицы не выводят лексер за их границы:
+//  каждый lookup меньше размера алфавита, таблица делится на строки,
+//  а каждый переход и номер DFA указывают на существующие состояние и DFA.
+bool IsValidStateMachine(const lexertl::state_machine::internals &internals)
+{
+	const size_t dfaCount = internals._dfa->size();
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		const size_t alphabet = internals._dfa_alphabet[dfa];
+		const auto &lookup = internals._lookup[dfa];
+		const auto &table = internals._dfa[dfa];
+		if (alphabet <= lexertl::transitions_index || table.size() % alphabet != 0)
+		{
+			return false;
+		}
+		const size_t stateCount = table.size() / alphabet;
+		if (stateCount < 2)
+		{
+			return false;
+		}
+		for (const size_t column : lookup)
+		{
+			if (column >= alphabet)
+			{
+				return false;
+			}
+		}
+
+		// Строка 0 хранит только начальное состояние для начала строки.
+		for (size_t column = 0; column < alphabet; ++column)
+		{
+			if (table[column] >= stateCount)
+			{
+				return false;
+			}
+		}
+		for (size_t state = 1; state < stateCount; ++state)
+		{
+			const size_t *row = table.data() + state * alphabet;
+			if (row[lexertl::eol_index] >= stateCount)
+			{
+				return false;
+			}
+			for (size_t column = lexertl::dead_state_index; column < alphabet; ++column)
+			{
+				if (row[column] >= stateCount)
+				{
+					return false;
+				}
+			}
+			if (row[lexertl::end_state_index] == 0)
+			{
+				continue;
+			}
+			const size_t id = row[lexertl::id_index];
+			const size_t pushDfa = row[lexertl::push_dfa_index];
+			if ((id > MAX_RULE_TOKEN_ID && id != lexertl::rules::skip())
+				|| row[lexertl::next_dfa_index] >= dfaCount
+				|| (pushDfa != lexertl::state_machine::npos() && pushDfa >= dfaCount))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::string ReadEnvironment(const char *name)
+{
+#ifdef _WIN32
+	char *value = nullptr;
+	size_t size = 0;
+	if (_dupenv_s(&value, &size, name) != 0 || value == nullptr)
+	{
+		return std::string();
+	}
+	std::string result(value);
+	std::free(value);
+	return result;
+#else
+	const char *value = std::getenv(name);
+	return (value == nullptr) ? std::string() : std::string(value);
+#endif
+}
+
+// Создаёт каталог кеша, доступный только владельцу, и проверяет, что ему
+//  можно доверять: это каталог текущего пользователя, куда не пишут другие.
+bool PrepareCacheDir(const std::string &dir)
+{
+	std::error_code error;
+	const fs::path path(dir);
+#ifdef _WIN32
+	// Каталоги профиля пользователя и так закрыты от других пользователей.
+	fs::create_directories(path, error);
+	return fs::is_directory(path, error);
+#else
+	if (path.has_parent_path())
+	{
+		fs::create_directories(path.parent_path(), error);
+	}
+	if (mkdir(dir.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+	{
+		return false;
+	}
+	struct stat info;
+	return lstat(dir.c_str(), &info) == 0
+		&& S_ISDIR(info.st_mode)
+		&& info.st_uid == geteuid()
+		&& (info.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+}
+
+std::string GetCacheFileName(uint64_t key)
+{
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << ".dfa";
+	return name.str();
+}
+}
+
+std::string GetDefaultDfaCacheDir()
+{
+	/*
+	 * Кеш лежит в каталоге пользователя: в общий временный каталог
+	 *  другой пользователь мог бы подложить свои таблицы.
+	 */
+#ifdef _WIN32
+	const std::string localAppData = ReadEnvironment("LOCALAPPDATA");
+	if (!localAppData.empty())
+	{
+		return (fs::path(localAppData) / "lexertl-scanner" / "dfa-cache").string();
+	}
+	const std::string tempSuffix;
+#else
+	const std::string xdgCacheHome = ReadEnvironment("XDG_CACHE_HOME");
+	if (!xdgCacheHome.empty())
+	{
+		return (fs::path(xdgCacheHome) / "lexertl-scanner").string();
+	}
+	const std::string home = ReadEnvironment("HOME");
+	if (!home.empty())
+	{
+		return (fs::path(home) / ".cache" / "lexertl-scanner").string();
+	}
+	// Чужой каталог с таким именем не пройдёт проверку PrepareCacheDir.
+	const std::string tempSuffix = "-" + std::to_string(geteuid());
+#endif
+	std::error_code error;
+	const fs::path tempDir = fs::temp_directory_path(error);
+	if (error)
+	{
+		return std::string();
+	}
+	return (tempDir / ("lexertl-scanner-cache" + tempSuffix)).string();
+}
+
+bool SaveStateMachine(const lexertl::state_machine &lexer, uint64_t key, const std::string &path)
+{
+	const auto &internals = lexer.data();
+	const size_t dfaCount = internals._dfa->size();
+
+	std::vector<uint64_t> body;
+	body.push_back(internals._eoi);
+	body.push_back(internals._features);
+	body.push_back(dfaCount);
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		const auto &lookup = internals._lookup[dfa];
+		const auto &table = internals._dfa[dfa];
+		body.push_back(internals._dfa_alphabet[dfa]);
+		body.push_back(table.size());
+		body.insert(body.end(), lookup.begin(), lookup.end());
+		body.insert(body.end(), table.begin(), table.end());
+	}
+
+	CacheHeader header;
+	std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.key = key;
+	header.checksum = HashBytes(body.data(), body.size() * sizeof(uint64_t));
+	header.bodySize = body.size();
+
+	// Случайный суффикс разводит временные файлы одновременно работающих сканеров.
+	const std::string tempPath = path + ".tmp" + std::to_string(std::random_device()());
+	{
+		std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
+		output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char *>(body.data()), static_cast<std::streamsize>(body.size() * sizeof(uint64_t)));
+		output.close();
+		if (!output)
+		{
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(tempPath, path, error);
+	if (error)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool LoadStateMachine(const std::string &path, uint64_t key, lexertl::state_machine &lexer)
+{
+	std::ifstream input(path, std::ios::binary);
+	CacheHeader header;
+	if (!input.read(reinterpret_cast<char *>(&header), sizeof(header))
+		|| std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+		|| header.key != key)
+	{
+		return false;
+	}
+
+	/*
+	 * Размер тела сверяется с размером файла до выделения памяти,
+	 *  а контрольная сумма защищает таблицы от порчи файла.
+	 */
+	std::error_code error;
+	const uintmax_t fileSize = fs::file_size(path, error);
+	if (error || (fileSize - sizeof(header)) % sizeof(uint64_t) != 0
+		|| (fileSize - sizeof(header)) / sizeof(uint64_t) != header.bodySize)
+	{
+		return false;
+	}
+	std::vector<uint64_t> body(static_cast<size_t>(header.bodySize));
+	if (!input.read(reinterpret_cast<char *>(body.data()), static_cast<std::streamsize>(body.size() * sizeof(uint64_t)))
+		|| HashBytes(body.data(), body.size() * sizeof(uint64_t)) != header.checksum)
+	{
+		return false;
+	}
+
+	BodyReader reader(body);
+	uint64_t eoi = 0;
+	uint64_t features = 0;
+	uint64_t dfaCount = 0;
+	if (!reader.Read(eoi) || !reader.Read(features) || !reader.Read(dfaCount) || dfaCount > body.size())
+	{
+		return false;
+	}
+
+	lexer.clear();
+	auto &internals = lexer.data();
+	internals._eoi = static_cast<size_t>(eoi);
+	internals._features = static_cast<size_t>(features);
+	internals.add_states(static_cast<size_t>(dfaCount));
+	for (size_t dfa = 0; dfa < dfaCount; ++dfa)
+	{
+		uint64_t alphabet = 0;
+		uint64_t tableSize = 0;
+		auto &lookup = internals._lookup[dfa];
+		auto &table = internals._dfa[dfa];
+		if (!reader.Read(alphabet) || !reader.Read(tableSize)
+			|| !reader.Read(lookup, lookup.size()) || !reader.Read(table, tableSize))
+		{
+			lexer.clear();
+			return false;
+		}
+		internals._dfa_alphabet[dfa] = static_cast<size_t>(alphabet);
+	}
+	if (!reader.AtEnd() || !IsValidStateMachine(internals))
+	{
+		lexer.clear();
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<lexertl::state_machine> LoadRuleSpecLexer(const std::string &specPath, const std::string &cacheDir)
+{
+	const std::string spec = ReadRuleSpec(specPath);
+	const uint64_t key = HashBytes(spec.data(), spec.size());
+	auto lexer = std::make_unique<lexertl::state_machine>();
+
+	std::string cachePath;
+	if (!cacheDir.empty() && PrepareCacheDir(cacheDir))
+	{
+		cachePath = (fs::path(cacheDir) / GetCacheFileName(key)).string();
+		if (LoadStateMachine(cachePath, key, *lexer))
+		{
+			return lexer;
+		}
+	}
+
+	// Кеш читается много раз, поэтому DFA стоит один раз минимизировать.
+	lexertl::generator::build(ParseRuleSpec(spec), *lexer);
+	lexer->minimise();
+
+	if (!cachePath.empty())
+	{
+		SaveStateMachine(*lexer, key, cachePath);
+	}
+	return lexer;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "lexertl/state_machine.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Каталог кеша DFA по умолчанию - в каталоге кешей текущего пользователя.
+std::string GetDefaultDfaCacheDir();
+
+// Сохраняет таблицы DFA в файл вместе с ключом `key`.
+// Файл сначала пишется под временным именем и затем переименовывается,
+//  чтобы параллельно запущенный сканер не прочитал его недописанным.
+// Возвращает false при ошибке записи.
+bool SaveStateMachine(const lexertl::state_machine &lexer, uint64_t key, const std::string &path);
+
+// Загружает таблицы DFA, сохранённые SaveStateMachine с тем же ключом.
+// Возвращает false, если файла нет, ключ другой, файл повреждён
+//  или таблицы ссылаются за свои границы.
+bool LoadStateMachine(const std::string &path, uint64_t key, lexertl::state_machine &lexer);
+
+// Создаёт DFA по файлу правил (см. ParseRuleSpec).
+// Если `cacheDir` не пуст, DFA берётся из кеша по хешу текста правил,
+//  а при промахе строится, минимизируется и сохраняется в кеш.
+// Каталог кеша создаётся доступным только владельцу; каталог, куда могут
+//  писать другие пользователи, не используется.
+// Ошибки кеша не фатальны: DFA тогда просто строится заново.
+// Бросает std::runtime_error, если правила нельзя прочитать или они неверны.
+std::unique_ptr<lexertl::state_machine> LoadRuleSpecLexer(const std::string &specPath, const std::string &cacheDir);
@@ -0,0 +1,107 @@
+#include "FileScanner.h"
+#include "InputReader.h"
+#include "OrderedOutput.h"
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+// Сколько файлов на поток может быть в работе сверх первого незаписанного.
+constexpr size_t FILES_IN_FLIGHT_PER_THREAD = 4;
+
+// Сколько байт вывода на поток может ждать своей очереди в памяти.
+constexpr size_t BUFFERED_OUTPUT_PER_THREAD = 8 << 20;
+}
+
+std::vector<std::string> CollectInputFiles(const std::vector<std::string> &paths)
+{
+	namespace fs = std::filesystem;
+	std::vector<std::string> files;
+	for (const std::string &path : paths)
+	{
+		if (!fs::is_directory(path))
+		{
+			files.push_back(path);
+			continue;
+		}
+		std::vector<std::string> directoryFiles;
+		for (const auto &entry : fs::recursive_directory_iterator(path))
+		{
+			if (entry.is_regular_file())
+			{
+				directoryFiles.push_back(entry.path().string());
+			}
+		}
+		std::sort(directoryFiles.begin(), directoryFiles.end());
+		files.insert(files.end(), directoryFiles.begin(), directoryFiles.end());
+	}
+	return files;
+}
+
+bool ScanFiles(const lexertl::state_machine &lexer, const std::vector<std::string> &files,
+	OutputFormat format, std::FILE *output, size_t threadCount, ScanStats *stats)
+{
+	threadCount = std::max<size_t>(1, threadCount);
+	OrderedOutput orderedOutput(output, files,
+		threadCount * FILES_IN_FLIGHT_PER_THREAD, threadCount * BUFFERED_OUTPUT_PER_THREAD);
+	std::mutex statsMutex;
+
+	// Каждый поток переиспользует один писатель и его буфер для всех своих файлов.
+	auto scanFiles = [&]() {
+		ScanStats threadStats;
+		size_t index = 0;
+		TokenWriter writer(format, [&](const char *data, size_t size) {
+			return orderedOutput.Write(index, data, size);
+		});
+		auto writeToken = [&writer](const lexertl::cmatch &token, size_t offset) {
+			writer.Write(token.id, token.first, static_cast<size_t>(token.second - token.first), offset);
+		};
+
+		while (orderedOutput.TakeNextFile(index))
+		{
+			writer.WriteFileStart(files[index]);
+			bool ok = false;
+			if (stats != nullptr)
+			{
+				ProfilingHandler<decltype(writeToken)> profilingHandler(threadStats, writeToken);
+				ok = ScanFile(lexer, files[index].c_str(), profilingHandler);
+			}
+			else
+			{
+				ok = ScanFile(lexer, files[index].c_str(), writeToken);
+			}
+
+			PhaseTimer finishTimer;
+			if (!ok)
+			{
+				// Непрочитанный файл не дал токенов, отбрасываем и его заголовок.
+				writer.Discard();
+			}
+			writer.Flush();
+			orderedOutput.FinishFile(index, ok);
+			if (stats != nullptr)
+			{
+				threadStats.AddTime(ScanPhase::Output, finishTimer.Elapsed());
+			}
+		}
+
+		if (stats != nullptr)
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats->Merge(threadStats);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		threads.emplace_back(scanFiles);
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	return orderedOutput.IsOk();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ScanStats.h"
+#include "TokenWriter.h"
+#include "lexertl/state_machine.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Раскрывает каталоги в список файлов, рекурсивно и в порядке имён,
+//  остальные пути оставляет как есть.
+std::vector<std::string> CollectInputFiles(const std::vector<std::string> &paths);
+
+// Сканирует файлы в `threadCount` потоках общим неизменяемым лексером
+//  и пишет в `output` вывод каждого файла целиком, в порядке списка.
+// Вывод первого ещё не записанного файла пишется сразу, а вывод следующих
+//  копится в памяти, пока не подойдёт их очередь. Памяти на это уходит
+//  не больше заданного предела: упёршийся в него поток ждёт своей очереди.
+// Если `stats` не равен nullptr, в него добавляется статистика всех потоков.
+// Возвращает false, если какой-то файл не удалось прочитать
+//  или вывод не удалось записать.
+bool ScanFiles(const lexertl::state_machine &lexer, const std::vector<std::string> &files,
+	OutputFormat format, std::FILE *output, size_t threadCount, ScanStats *stats = nullptr);
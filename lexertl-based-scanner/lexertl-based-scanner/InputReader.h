@@ -0,0 +1,108 @@
+#pragma once
+
+#include "lexertl/iterator.hpp"
+#include "lexertl/memory_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Размер блока, которым читается поток ввода.
+constexpr size_t INPUT_BLOCK_SIZE = 1 << 20;
+
+// Есть ли у обработчика метод OnRangeScanned(begin, end).
+template <class Handler, class = void>
+struct HasOnRangeScanned : std::false_type
+{
+};
+
+template <class Handler>
+struct HasOnRangeScanned<Handler,
+	std::void_t<decltype(std::declval<Handler &>().OnRangeScanned(nullptr, nullptr))>> : std::true_type
+{
+};
+
+// Проходит диапазон [begin, end) лексером за один проход
+//  и передаёт обработчику каждый токен и его смещение от начала ввода.
+// `baseOffset` - смещение `begin` от начала ввода.
+// Если у обработчика есть метод OnRangeScanned, он вызывается в конце,
+//  пока память диапазона ещё доступна.
+template <class Handler>
+void ScanRange(const lexertl::state_machine &lexer, const char *begin, const char *end,
+	size_t baseOffset, Handler &handler)
+{
+	lexertl::citerator iter(begin, end, lexer);
+	lexertl::citerator iterEnd;
+	for (; iter != iterEnd; ++iter)
+	{
+		handler(*iter, baseOffset + static_cast<size_t>(iter->first - begin));
+	}
+	if constexpr (HasOnRangeScanned<Handler>::value)
+	{
+		handler.OnRangeScanned(begin, end);
+	}
+}
+
+// Отображает файл в память и проходит его лексером целиком,
+//  без копирования и без выделения памяти на каждую строку.
+// Возвращает false, если файл не удалось открыть.
+template <class Handler>
+bool ScanFile(const lexertl::state_machine &lexer, const char *path, Handler &handler)
+{
+	lexertl::memory_file file(path);
+	if (file.data() == nullptr)
+	{
+		// Пустой файл нельзя отобразить в память, но это не ошибка.
+		std::ifstream check(path, std::ios::binary);
+		return check && check.peek() == std::ifstream::traits_type::eof();
+	}
+	ScanRange(lexer, file.data(), file.data() + file.size(), 0, handler);
+	return true;
+}
+
+// Читает поток большими блоками и передаёт лексеру только целые строки,
+//  а незаконченная строка переносится в начало буфера.
+// Так токены не разрываются на границе блоков, как и при построчном чтении.
+// Возвращает false при ошибке чтения.
+template <class Handler>
+bool ScanStream(const lexertl::state_machine &lexer, std::FILE *input, Handler &handler)
+{
+	std::vector<char> buffer(INPUT_BLOCK_SIZE);
+	size_t filled = 0;
+	size_t baseOffset = 0;
+	for (;;)
+	{
+		if (filled == buffer.size())
+		{
+			// Строка длиннее буфера, увеличиваем его.
+			buffer.resize(buffer.size() * 2);
+		}
+		const size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, input);
+		filled += read;
+		const bool atEnd = (read == 0);
+
+		size_t scanSize = filled;
+		if (!atEnd)
+		{
+			const auto lastNewline = std::find(buffer.rbegin() + (buffer.size() - filled), buffer.rend(), '\n');
+			if (lastNewline == buffer.rend())
+			{
+				continue;
+			}
+			scanSize = static_cast<size_t>(buffer.rend() - lastNewline);
+		}
+
+		ScanRange(lexer, buffer.data(), buffer.data() + scanSize, baseOffset, handler);
+		std::memmove(buffer.data(), buffer.data() + scanSize, filled - scanSize);
+		filled -= scanSize;
+		baseOffset += scanSize;
+
+		if (atEnd)
+		{
+			return std::ferror(input) == 0;
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#include "OrderedOutput.h"
+#include <iostream>
+
+OrderedOutput::OrderedOutput(std::FILE *output, const std::vector<std::string> &files,
+	size_t maxInFlight, size_t maxBufferedBytes)
+	: m_output(output)
+	, m_paths(files)
+	, m_files(files.size())
+	, m_maxInFlight(maxInFlight)
+	, m_maxBufferedBytes(maxBufferedBytes)
+{
+}
+
+bool OrderedOutput::TakeNextFile(size_t &index)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_changed.wait(lock, [&] {
+		return m_nextFile >= m_files.size() || m_nextFile < m_head + m_maxInFlight;
+	});
+	if (m_nextFile >= m_files.size())
+	{
+		return false;
+	}
+	index = m_nextFile++;
+	return true;
+}
+
+bool OrderedOutput::Write(size_t index, const char *data, size_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_changed.wait(lock, [&] {
+		return m_head == index || m_bufferedBytes + size <= m_maxBufferedBytes;
+	});
+	FileState &file = m_files[index];
+	if (m_head != index)
+	{
+		file.pending.insert(file.pending.end(), data, data + size);
+		m_bufferedBytes += size;
+		return true;
+	}
+
+	/*
+	 * Пока файл головной, его вывод пишет только его поток,
+	 *  поэтому писать можно без блокировки.
+	 */
+	std::vector<char> pending = std::move(file.pending);
+	file.pending.clear();
+	m_bufferedBytes -= pending.size();
+	lock.unlock();
+	m_changed.notify_all();
+	const bool pendingWritten = WriteToOutput(pending.data(), pending.size());
+	return WriteToOutput(data, size) && pendingWritten;
+}
+
+void OrderedOutput::FinishFile(size_t index, bool ok)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_files[index].done = true;
+	m_files[index].ok = ok;
+	if (m_head == index)
+	{
+		WriteFinishedHeadFiles(lock);
+	}
+}
+
+bool OrderedOutput::IsOk() const
+{
+	return m_allFilesRead && !m_writeFailed && std::fflush(m_output) == 0;
+}
+
+void OrderedOutput::WriteFinishedHeadFiles(std::unique_lock<std::mutex> &lock)
+{
+	while (m_head < m_files.size() && m_files[m_head].done)
+	{
+		FileState &file = m_files[m_head];
+		const std::vector<char> pending = std::move(file.pending);
+		file.pending.clear();
+		m_bufferedBytes -= pending.size();
+		const bool fileOk = file.ok;
+		const size_t index = m_head;
+		lock.unlock();
+
+		if (!fileOk)
+		{
+			std::cerr << "Cannot read file " << m_paths[index] << "\n";
+			m_allFilesRead = false;
+		}
+		WriteToOutput(pending.data(), pending.size());
+
+		lock.lock();
+		++m_head;
+		m_changed.notify_all();
+	}
+}
+
+bool OrderedOutput::WriteToOutput(const char *data, size_t size)
+{
+	if (size != 0 && std::fwrite(data, 1, size, m_output) != size)
+	{
+		m_writeFailed = true;
+		return false;
+	}
+	return true;
+}
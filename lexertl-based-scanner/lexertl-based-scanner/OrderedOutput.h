@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Пишет вывод файлов в `output` в порядке списка.
+// Головной файл - первый, чей вывод ещё не записан целиком.
+// Его вывод пишется сразу, вывод остальных копится в памяти до их очереди.
+// Файл, вывод которого целиком накоплен к моменту его очереди,
+//  записывает поток, закончивший предыдущий головной файл.
+class OrderedOutput
+{
+public:
+	// В работе может быть не больше `maxInFlight` файлов, считая от головного,
+	//  а в памяти - не больше `maxBufferedBytes` байт вывода неголовных файлов.
+	OrderedOutput(std::FILE *output, const std::vector<std::string> &files,
+		size_t maxInFlight, size_t maxBufferedBytes);
+
+	// Выдаёт номер следующего файла, когда он не слишком далеко от головного.
+	// Возвращает false, если файлы кончились.
+	bool TakeNextFile(size_t &index);
+
+	// Пишет кусок вывода файла `index` или откладывает его до очереди файла.
+	// Если отложить некуда, ждёт, пока файл станет головным или память освободится.
+	bool Write(size_t index, const char *data, size_t size);
+
+	// Отмечает, что весь вывод файла передан через Write.
+	void FinishFile(size_t index, bool ok);
+
+	// Можно вызывать, когда все потоки закончили работу.
+	bool IsOk() const;
+
+private:
+	struct FileState
+	{
+		std::vector<char> pending;
+		bool done = false;
+		bool ok = false;
+	};
+
+	// Вызывается владельцем головного файла, когда файл закончен.
+	void WriteFinishedHeadFiles(std::unique_lock<std::mutex> &lock);
+
+	bool WriteToOutput(const char *data, size_t size);
+
+	std::FILE *m_output;
+	const std::vector<std::string> &m_paths;
+	std::vector<FileState> m_files;
+	const size_t m_maxInFlight;
+	const size_t m_maxBufferedBytes;
+
+	std::mutex m_mutex;
+	std::condition_variable m_changed;
+	size_t m_nextFile = 0;
+	size_t m_head = 0;
+	size_t m_bufferedBytes = 0;
+	// Меняет только поток, владеющий головным файлом.
+	bool m_allFilesRead = true;
+	bool m_writeFailed = false;
+};
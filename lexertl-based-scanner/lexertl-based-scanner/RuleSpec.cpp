@@ -0,0 +1,112 @@
+#include "RuleSpec.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+const char SPACES[] = " \t";
+
+// Отделяет первое слово строки, `rest` получает остаток без ведущих пробелов.
+std::string TakeWord(const std::string &line, std::string &rest)
+{
+	const size_t begin = line.find_first_not_of(SPACES);
+	if (begin == std::string::npos)
+	{
+		rest.clear();
+		return std::string();
+	}
+	const size_t end = std::min(line.find_first_of(SPACES, begin), line.size());
+	const size_t restBegin = line.find_first_not_of(SPACES, end);
+	rest = (restBegin == std::string::npos) ? std::string() : line.substr(restBegin);
+	return line.substr(begin, end - begin);
+}
+
+[[noreturn]] void ThrowSpecError(size_t lineNumber, const std::string &message)
+{
+	std::ostringstream text;
+	text << "Rules line " << lineNumber << ": " << message;
+	throw std::runtime_error(text.str());
+}
+
+size_t ParseTokenId(const std::string &word, size_t lineNumber)
+{
+	char *end = nullptr;
+	const unsigned long long id = std::strtoull(word.c_str(), &end, 10);
+	if (word.empty() || *end != '\0' || id == 0 || id > MAX_RULE_TOKEN_ID)
+	{
+		ThrowSpecError(lineNumber, "token id must be a number from 1 to " + std::to_string(MAX_RULE_TOKEN_ID));
+	}
+	return static_cast<size_t>(id);
+}
+}
+
+lexertl::rules ParseRuleSpec(const std::string &spec)
+{
+	lexertl::rules rules;
+	bool hasTokens = false;
+	std::istringstream lines(spec);
+	std::string line;
+	for (size_t lineNumber = 1; std::getline(lines, line); ++lineNumber)
+	{
+		// Пробелы в конце строки не видны в редакторе, поэтому в regex не входят.
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+
+		std::string rest;
+		const std::string directive = TakeWord(line, rest);
+		if (directive.empty() || directive[0] == '#')
+		{
+			continue;
+		}
+
+		if (directive == "macro" || directive == "token")
+		{
+			std::string regex;
+			const std::string name = TakeWord(rest, regex);
+			if (regex.empty())
+			{
+				ThrowSpecError(lineNumber, "expected '" + directive + " <" + (directive == "macro" ? "name" : "id") + "> <regex>'");
+			}
+			if (directive == "macro")
+			{
+				rules.insert_macro(name.c_str(), regex);
+			}
+			else
+			{
+				rules.push(regex, ParseTokenId(name, lineNumber));
+				hasTokens = true;
+			}
+		}
+		else if (directive == "skip")
+		{
+			if (rest.empty())
+			{
+				ThrowSpecError(lineNumber, "expected 'skip <regex>'");
+			}
+			rules.push(rest, rules.skip());
+		}
+		else
+		{
+			ThrowSpecError(lineNumber, "unknown directive '" + directive + "'");
+		}
+	}
+
+	if (!hasTokens)
+	{
+		throw std::runtime_error("Rules contain no tokens");
+	}
+	return rules;
+}
+
+std::string ReadRuleSpec(const std::string &path)
+{
+	std::ifstream input(path, std::ios::binary);
+	if (!input)
+	{
+		throw std::runtime_error("Cannot read rules file " + path);
+	}
+	return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
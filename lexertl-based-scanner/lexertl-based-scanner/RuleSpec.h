@@ -0,0 +1,21 @@
+#pragma once
+
+#include "lexertl/rules.hpp"
+#include <string>
+
+// Наибольший ID токена в файле правил.
+// ID ограничены, чтобы счётчики --stats оставались небольшим массивом.
+constexpr size_t MAX_RULE_TOKEN_ID = 0xFFFF;
+
+// Разбирает текст файла правил - по одной директиве на строку:
+//   # комментарий
+//   macro <имя> <regex>   - макрос, в правилах он пишется как {имя}
+//   token <id> <regex>    - токен с ID от 1 до MAX_RULE_TOKEN_ID
+//   skip <regex>          - совпадение пропускается, как пробелы
+// Regex - остаток строки после пробелов, следующих за именем или ID,
+//  без пробелов в конце строки; пробел в конце regex пишется как [ ] или \x20.
+// Бросает std::runtime_error с номером строки, если текст неверен.
+lexertl::rules ParseRuleSpec(const std::string &spec);
+
+// Читает файл правил целиком, бросает std::runtime_error при ошибке.
+std::string ReadRuleSpec(const std::string &path);
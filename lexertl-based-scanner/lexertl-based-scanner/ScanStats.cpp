@@ -0,0 +1,159 @@
+#include "ScanStats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace
+{
+double GetThreadCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime;
+	FILETIME exitTime;
+	FILETIME kernelTime;
+	FILETIME userTime;
+	if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		return 0;
+	}
+	auto toTicks = [](const FILETIME &time) {
+		return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	};
+	// FILETIME считает интервалами по 100 нс.
+	return static_cast<double>(toTicks(kernelTime) + toTicks(userTime)) * 1e-7;
+#else
+	timespec time;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+	{
+		return 0;
+	}
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) * 1e-9;
+#endif
+}
+
+PhaseTime ReadPhaseClocks()
+{
+	PhaseTime time;
+	time.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	time.cpuSeconds = GetThreadCpuSeconds();
+	return time;
+}
+
+const char *const PHASE_NAMES[SCAN_PHASE_COUNT] = { "build", "lex", "output" };
+}
+
+PhaseTimer::PhaseTimer()
+	: m_start(ReadPhaseClocks())
+{
+}
+
+PhaseTime PhaseTimer::Elapsed() const
+{
+	const PhaseTime now = ReadPhaseClocks();
+	PhaseTime elapsed;
+	elapsed.wallSeconds = now.wallSeconds - m_start.wallSeconds;
+	elapsed.cpuSeconds = now.cpuSeconds - m_start.cpuSeconds;
+	return elapsed;
+}
+
+PhaseTime PhaseTimer::Restart()
+{
+	const PhaseTime elapsed = Elapsed();
+	m_start.wallSeconds += elapsed.wallSeconds;
+	m_start.cpuSeconds += elapsed.cpuSeconds;
+	return elapsed;
+}
+
+void ScanStats::CountInput(const char *begin, const char *end)
+{
+	m_inputBytes += static_cast<uint64_t>(end - begin);
+	m_lines += static_cast<uint64_t>(std::count(begin, end, '\n'));
+	if (begin != end && end[-1] != '\n')
+	{
+		// Последняя строка без перевода строки.
+		++m_lines;
+	}
+}
+
+void ScanStats::AddTime(ScanPhase phase, const PhaseTime &time)
+{
+	PhaseTime &total = m_times[static_cast<size_t>(phase)];
+	total.wallSeconds += time.wallSeconds;
+	total.cpuSeconds += time.cpuSeconds;
+}
+
+void ScanStats::Merge(const ScanStats &other)
+{
+	if (other.m_tokens.size() > m_tokens.size())
+	{
+		m_tokens.resize(other.m_tokens.size());
+	}
+	for (size_t i = 0; i < other.m_tokens.size(); ++i)
+	{
+		m_tokens[i].count += other.m_tokens[i].count;
+		m_tokens[i].bytes += other.m_tokens[i].bytes;
+	}
+	m_inputBytes += other.m_inputBytes;
+	m_lines += other.m_lines;
+	for (size_t i = 0; i < SCAN_PHASE_COUNT; ++i)
+	{
+		AddTime(static_cast<ScanPhase>(i), other.m_times[i]);
+	}
+}
+
+void ScanStats::Print(std::ostream &out, double scanWallSeconds) const
+{
+	uint64_t tokenCount = 0;
+	for (const TokenCounter &counter : m_tokens)
+	{
+		tokenCount += counter.count;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "Input: " << m_inputBytes << " bytes, " << m_lines << " lines, " << tokenCount << " tokens\n";
+
+	// При нескольких потоках время разбора и вывода суммируется по всем потокам.
+	out << std::left << std::setw(6) << "Phase" << std::right
+		<< std::setw(13) << "Wall, ms" << std::setw(13) << "CPU, ms" << "\n";
+	for (size_t i = 0; i < SCAN_PHASE_COUNT; ++i)
+	{
+		out << std::left << std::setw(6) << PHASE_NAMES[i] << std::right
+			<< std::setw(13) << m_times[i].wallSeconds * 1000
+			<< std::setw(13) << m_times[i].cpuSeconds * 1000 << "\n";
+	}
+
+	if (scanWallSeconds > 0)
+	{
+		out << "Throughput: " << static_cast<double>(m_inputBytes) / (1024 * 1024) / scanWallSeconds << " MB/s, "
+			<< std::setprecision(0) << static_cast<double>(tokenCount) / scanWallSeconds << " tokens/s\n"
+			<< std::setprecision(3);
+	}
+
+	out << std::left << std::setw(4) << "Id" << std::right
+		<< std::setw(13) << "Tokens" << std::setw(13) << "Bytes" << "\n";
+	for (size_t i = 0; i < m_tokens.size(); ++i)
+	{
+		if (m_tokens[i].count == 0)
+		{
+			continue;
+		}
+		// Нераспознанные символы выводятся с ID -1, как в формате NDJSON.
+		out << std::left << std::setw(4);
+		if (i == 0)
+		{
+			out << "-1";
+		}
+		else
+		{
+			out << i - 1;
+		}
+		out << std::right << std::setw(13) << m_tokens[i].count << std::setw(13) << m_tokens[i].bytes << "\n";
+	}
+}
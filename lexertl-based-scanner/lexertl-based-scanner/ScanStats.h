@@ -0,0 +1,145 @@
+#pragma once
+
+#include "lexertl/match_results.hpp"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Этапы работы сканера, время которых измеряется в режиме --stats.
+enum class ScanPhase
+{
+	// Построение DFA в lexertl::generator::build.
+	Build,
+	// Чтение ввода и разбор его лексером.
+	Lex,
+	// Форматирование и запись токенов.
+	Output,
+};
+
+constexpr size_t SCAN_PHASE_COUNT = 3;
+
+// Время этапа: по часам и процессорное время потока.
+struct PhaseTime
+{
+	double wallSeconds = 0;
+	double cpuSeconds = 0;
+};
+
+// Засекает время по часам и процессорное время вызывающего потока.
+class PhaseTimer
+{
+public:
+	PhaseTimer();
+
+	// Возвращает время с момента создания или прошлого вызова Restart.
+	PhaseTime Elapsed() const;
+
+	// То же, что Elapsed, но заодно начинает отсчёт заново.
+	PhaseTime Restart();
+
+private:
+	PhaseTime m_start;
+};
+
+// Счётчики режима --stats: число и суммарная длина токенов каждого ID,
+//  объём и число строк ввода, время каждого этапа.
+// Каждый поток ведёт свои счётчики, а в конце они складываются через Merge.
+class ScanStats
+{
+public:
+	void CountToken(size_t id, size_t length)
+	{
+		const size_t index = (id == lexertl::cmatch::npos()) ? 0 : id + 1;
+		if (index >= m_tokens.size())
+		{
+			m_tokens.resize(index + 1);
+		}
+		++m_tokens[index].count;
+		m_tokens[index].bytes += length;
+	}
+
+	// Учитывает диапазон ввода, уже пройденный лексером.
+	void CountInput(const char *begin, const char *end);
+
+	void AddTime(ScanPhase phase, const PhaseTime &time);
+
+	void Merge(const ScanStats &other);
+
+	// Печатает отчёт; `scanWallSeconds` - сколько по часам длились
+	//  чтение, разбор и вывод вместе, от него считается пропускная способность.
+	void Print(std::ostream &out, double scanWallSeconds) const;
+
+private:
+	struct TokenCounter
+	{
+		uint64_t count = 0;
+		uint64_t bytes = 0;
+	};
+
+	// Элемент 0 - нераспознанные символы, элемент id + 1 - токены с этим ID.
+	std::vector<TokenCounter> m_tokens;
+	uint64_t m_inputBytes = 0;
+	uint64_t m_lines = 0;
+	PhaseTime m_times[SCAN_PHASE_COUNT];
+};
+
+// Обработчик токенов для ScanRange, который считает статистику
+//  и делит время между разбором и выводом.
+// Чтобы не засекать время на каждом токене, он копит токены пачкой
+//  и передаёт их обработчику `Handler` после разбора пачки или диапазона.
+template <class Handler>
+class ProfilingHandler
+{
+public:
+	ProfilingHandler(ScanStats &stats, Handler &handler)
+		: m_stats(stats)
+		, m_handler(handler)
+	{
+		m_batch.reserve(BATCH_SIZE);
+	}
+
+	ProfilingHandler(const ProfilingHandler &) = delete;
+	ProfilingHandler &operator=(const ProfilingHandler &) = delete;
+
+	void operator()(const lexertl::cmatch &token, size_t offset)
+	{
+		m_stats.CountToken(token.id, static_cast<size_t>(token.second - token.first));
+		m_batch.push_back({ token, offset });
+		if (m_batch.size() == BATCH_SIZE)
+		{
+			OutputBatch();
+		}
+	}
+
+	// Вызывается ScanRange после разбора диапазона, пока его память ещё доступна.
+	void OnRangeScanned(const char *begin, const char *end)
+	{
+		m_stats.CountInput(begin, end);
+		OutputBatch();
+	}
+
+private:
+	static constexpr size_t BATCH_SIZE = 4096;
+
+	struct PendingToken
+	{
+		lexertl::cmatch token;
+		size_t offset;
+	};
+
+	void OutputBatch()
+	{
+		m_stats.AddTime(ScanPhase::Lex, m_timer.Restart());
+		for (const PendingToken &pending : m_batch)
+		{
+			m_handler(pending.token, pending.offset);
+		}
+		m_batch.clear();
+		m_stats.AddTime(ScanPhase::Output, m_timer.Restart());
+	}
+
+	ScanStats &m_stats;
+	Handler &m_handler;
+	std::vector<PendingToken> m_batch;
+	PhaseTimer m_timer;
+};
@@ -0,0 +1,190 @@
+#include "TokenWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace
+{
+// Размер буфера вывода.
+constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+// Самая длинная запись без учёта текста токена.
+constexpr size_t MAX_RECORD_OVERHEAD = 128;
+
+constexpr size_t NO_TOKEN_ID = std::numeric_limits<size_t>::max();
+}
+
+TokenWriter::TokenWriter(std::FILE *output, OutputFormat format)
+	: m_output(output)
+	, m_format(format)
+	, m_buffer(OUTPUT_BUFFER_SIZE)
+{
+}
+
+TokenWriter::TokenWriter(OutputFormat format, OutputSink sink)
+	: m_format(format)
+	, m_sink(std::move(sink))
+	, m_buffer(OUTPUT_BUFFER_SIZE)
+{
+}
+
+TokenWriter::~TokenWriter()
+{
+	Flush();
+}
+
+void TokenWriter::Write(size_t id, const char *text, size_t length, size_t offset)
+{
+	// В JSON каждый байт текста может превратиться в 6 символов.
+	Reserve(MAX_RECORD_OVERHEAD + 6 * length);
+
+	switch (m_format)
+	{
+	case OutputFormat::Text:
+		Append("Id: ", 4);
+		AppendNumber(id);
+		Append(", Token: '", 10);
+		Append(text, length);
+		Append("'\n", 2);
+		break;
+	case OutputFormat::Binary:
+	{
+		const BinaryTokenRecord record{
+			id == NO_TOKEN_ID ? std::numeric_limits<uint32_t>::max() : static_cast<uint32_t>(id),
+			static_cast<uint32_t>(length),
+			static_cast<uint64_t>(offset),
+		};
+		Append(reinterpret_cast<const char *>(&record), sizeof(record));
+		break;
+	}
+	case OutputFormat::NdJson:
+		Append("{\"id\":", 6);
+		if (id == NO_TOKEN_ID)
+		{
+			Append("-1", 2);
+		}
+		else
+		{
+			AppendNumber(id);
+		}
+		Append(",\"offset\":", 10);
+		AppendNumber(offset);
+		Append(",\"length\":", 10);
+		AppendNumber(length);
+		Append(",\"text\":\"", 9);
+		AppendJsonString(text, length);
+		Append("\"}\n", 3);
+		break;
+	}
+}
+
+void TokenWriter::WriteFileStart(const std::string &path)
+{
+	Reserve(MAX_RECORD_OVERHEAD + 6 * path.size());
+	switch (m_format)
+	{
+	case OutputFormat::Text:
+		Append("File: ", 6);
+		Append(path.data(), path.size());
+		Append("\n", 1);
+		break;
+	case OutputFormat::Binary:
+	{
+		const BinaryTokenRecord record{ BINARY_FILE_RECORD_ID, static_cast<uint32_t>(path.size()), 0 };
+		Append(reinterpret_cast<const char *>(&record), sizeof(record));
+		Append(path.data(), path.size());
+		break;
+	}
+	case OutputFormat::NdJson:
+		Append("{\"file\":\"", 9);
+		AppendJsonString(path.data(), path.size());
+		Append("\"}\n", 3);
+		break;
+	}
+}
+
+void TokenWriter::Discard()
+{
+	m_size = 0;
+}
+
+bool TokenWriter::Flush()
+{
+	if (m_output == nullptr)
+	{
+		if (m_size != 0 && !m_sink(m_buffer.data(), m_size))
+		{
+			m_failed = true;
+		}
+		m_size = 0;
+		return !m_failed;
+	}
+	if (m_size != 0 && std::fwrite(m_buffer.data(), 1, m_size, m_output) != m_size)
+	{
+		m_failed = true;
+	}
+	m_size = 0;
+	if (std::fflush(m_output) != 0)
+	{
+		m_failed = true;
+	}
+	return !m_failed;
+}
+
+void TokenWriter::Reserve(size_t size)
+{
+	if (m_size + size <= m_buffer.size())
+	{
+		return;
+	}
+	Flush();
+	if (size > m_buffer.size())
+	{
+		// Запись длиннее буфера, увеличиваем его.
+		m_buffer.resize(std::max(size, 2 * m_buffer.size()));
+	}
+}
+
+void TokenWriter::Append(const char *data, size_t size)
+{
+	std::memcpy(m_buffer.data() + m_size, data, size);
+	m_size += size;
+}
+
+void TokenWriter::AppendNumber(uint64_t value)
+{
+	// Цифры получаются с конца, поэтому пишем их во временный массив.
+	char digits[20];
+	size_t count = 0;
+	do
+	{
+		digits[sizeof(digits) - ++count] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	Append(digits + sizeof(digits) - count, count);
+}
+
+void TokenWriter::AppendJsonString(const char *text, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+	for (size_t i = 0; i < length; ++i)
+	{
+		const auto ch = static_cast<unsigned char>(text[i]);
+		if (ch == '"' || ch == '\\')
+		{
+			m_buffer[m_size++] = '\\';
+			m_buffer[m_size++] = static_cast<char>(ch);
+		}
+		else if (ch < 0x20 || ch >= 0x7F)
+		{
+			// Не-ASCII байты тоже экранируются, чтобы вывод всегда был корректным UTF-8.
+			const char escaped[] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xF] };
+			Append(escaped, sizeof(escaped));
+		}
+		else
+		{
+			m_buffer[m_size++] = static_cast<char>(ch);
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class OutputFormat
+{
+	// Id: <id>, Token: '<text>' - по строке на токен, как раньше.
+	Text,
+	// Записи BinaryTokenRecord подряд, порядок байт - как на машине сканера.
+	Binary,
+	// {"id":<id>,"offset":<offset>,"length":<length>,"text":"<text>"} - по строке на токен,
+	//  у нераспознанных символов id равен -1.
+	NdJson,
+};
+
+// Запись о токене в двоичном формате вывода.
+struct BinaryTokenRecord
+{
+	uint32_t id;     // ID токена, UINT32_MAX для нераспознанных символов
+	uint32_t length; // длина токена в байтах
+	uint64_t offset; // смещение токена от начала ввода в байтах
+};
+
+static_assert(sizeof(BinaryTokenRecord) == 16, "binary record must have no padding");
+
+// ID записи о начале файла в двоичном формате,
+//  за такой записью следуют `length` байт пути к файлу.
+constexpr uint32_t BINARY_FILE_RECORD_ID = UINT32_MAX - 1;
+
+// Получатель вывода: принимает очередной кусок вывода,
+//  возвращает false при ошибке записи.
+using OutputSink = std::function<bool(const char *data, size_t size)>;
+
+// Пишет токены в выбранном формате через собственный большой буфер.
+// Форматирование не создаёт временных строк
+//  и не выделяет память после создания буфера.
+class TokenWriter
+{
+public:
+	TokenWriter(std::FILE *output, OutputFormat format);
+
+	// Создаёт писатель, который отдаёт заполненный буфер получателю `sink`.
+	TokenWriter(OutputFormat format, OutputSink sink);
+	~TokenWriter();
+
+	TokenWriter(const TokenWriter &) = delete;
+	TokenWriter &operator=(const TokenWriter &) = delete;
+
+	void Write(size_t id, const char *text, size_t length, size_t offset);
+
+	// Пишет заголовок перед токенами файла `path`.
+	void WriteFileStart(const std::string &path);
+
+	// Отбрасывает вывод, ещё не записанный из буфера.
+	void Discard();
+
+	// Возвращает false при ошибке записи.
+	bool Flush();
+
+private:
+	void Reserve(size_t size);
+	void Append(const char *data, size_t size);
+	void AppendNumber(uint64_t value);
+	void AppendJsonString(const char *text, size_t length);
+
+	std::FILE *m_output = nullptr;
+	OutputFormat m_format = OutputFormat::Text;
+	OutputSink m_sink;
+	std::vector<char> m_buffer;
+	size_t m_size = 0;
+	bool m_failed = false;
+};
@@ -0,0 +1,339 @@
+#pragma once
+
+// Throughput benchmark harness shared by calc lexer projects.
+//
+// Define CALC_BENCH_IMPLEMENT in exactly one source file before including
+//  this header: it replaces global operator new/delete to count allocations.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace calc_bench
+{
+
+enum class CorpusKind
+{
+	Numbers,
+	Ids,
+	Operators,
+	Whitespace,
+	Errors,
+};
+
+// Lexes given text and returns number of tokens read.
+using LexFunction = std::function<size_t(const std::string& text)>;
+
+struct BenchmarkCase
+{
+	std::string name;
+	LexFunction lex;
+};
+
+inline std::atomic<size_t>& AllocationCount()
+{
+	static std::atomic<size_t> count{ 0 };
+	return count;
+}
+
+inline const char* GetCorpusName(CorpusKind kind)
+{
+	switch (kind)
+	{
+	case CorpusKind::Numbers:
+		return "numbers";
+	case CorpusKind::Ids:
+		return "ids";
+	case CorpusKind::Operators:
+		return "operators";
+	case CorpusKind::Whitespace:
+		return "whitespace";
+	case CorpusKind::Errors:
+		return "errors";
+	}
+	return "<UNEXPECTED!!!>";
+}
+
+inline std::string GenerateCorpus(CorpusKind kind, size_t size, unsigned seed = 2018)
+{
+	/*
+	 * Generates lines of calc expressions until `size` bytes are written.
+	 * Same seed always gives the same corpus.
+	 */
+	static const char* const ERRORS[] = { "05", "1..2", ".5", "3.", "0x1", "#", "5abc", "1.2.3" };
+	static const char OPERATORS[] = "+-*/=()";
+
+	std::mt19937 random(seed);
+	auto randomInt = [&](int from, int to) {
+		return std::uniform_int_distribution<int>(from, to)(random);
+	};
+	auto appendId = [&](std::string& text, int minLength, int maxLength) {
+		text += static_cast<char>('a' + randomInt(0, 25));
+		for (int i = randomInt(minLength, maxLength) - 1; i > 0; --i)
+		{
+			const int ch = randomInt(0, 37);
+			text += ch < 26 ? static_cast<char>('a' + ch) : ch < 36 ? static_cast<char>('0' + ch - 26) : '_';
+		}
+	};
+	auto appendNumber = [&](std::string& text) {
+		text += std::to_string(randomInt(1, 999999));
+		if (randomInt(0, 1))
+		{
+			text += '.';
+			text += std::to_string(randomInt(0, 9999));
+		}
+	};
+
+	std::string text;
+	text.reserve(size + 128);
+	while (text.size() < size)
+	{
+		switch (kind)
+		{
+		case CorpusKind::Numbers:
+			appendNumber(text);
+			text += randomInt(0, 3) ? " + " : "\n";
+			break;
+		case CorpusKind::Ids:
+			appendId(text, 8, 40);
+			text += randomInt(0, 3) ? " * " : "\n";
+			break;
+		case CorpusKind::Operators:
+			text += OPERATORS[randomInt(0, 6)];
+			if (randomInt(0, 7) == 0)
+			{
+				text += 'x';
+			}
+			break;
+		case CorpusKind::Whitespace:
+			text.append(static_cast<size_t>(randomInt(8, 64)), randomInt(0, 3) ? ' ' : '\t');
+			appendId(text, 1, 4);
+			text += randomInt(0, 1) ? " +" : "\n";
+			break;
+		case CorpusKind::Errors:
+			text += ERRORS[randomInt(0, 7)];
+			text += randomInt(0, 1) ? " - " : " ";
+			break;
+		}
+	}
+	text.resize(size);
+	return text;
+}
+
+inline size_t GetPeakRss()
+{
+	/*
+	 * Returns peak resident set size of the process in bytes.
+	 */
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#if defined(__APPLE__)
+	return static_cast<size_t>(usage.ru_maxrss);
+#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+inline size_t ParseSize(const char* text)
+{
+	/*
+	 * Parses size like 512, 64K, 16M or 1G.
+	 */
+	char* suffix = nullptr;
+	size_t size = std::strtoull(text, &suffix, 10);
+	switch (*suffix)
+	{
+	case 'G':
+	case 'g':
+		size *= 1024;
+		// fallthrough
+	case 'M':
+	case 'm':
+		size *= 1024;
+		// fallthrough
+	case 'K':
+	case 'k':
+		size *= 1024;
+		break;
+	default:
+		break;
+	}
+	return size;
+}
+
+inline std::string FormatSize(size_t size)
+{
+	static const char* const SUFFIXES[] = { "B", "KB", "MB", "GB" };
+	size_t index = 0;
+	while (size >= 1024 && size % 1024 == 0 && index < 3)
+	{
+		size /= 1024;
+		++index;
+	}
+	return std::to_string(size) + SUFFIXES[index];
+}
+
+struct BenchmarkOptions
+{
+	size_t minSize = 1024;
+	size_t maxSize = 32 * 1024 * 1024;
+	double minSeconds = 0.5;
+	std::string filter;
+};
+
+inline bool ParseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		auto valueOf = [&](const char* name) -> const char* {
+			const size_t length = std::strlen(name);
+			return arg.compare(0, length, name) == 0 ? argv[i] + length : nullptr;
+		};
+		if (const char* value = valueOf("--min-size="))
+		{
+			options.minSize = ParseSize(value);
+		}
+		else if (const char* value = valueOf("--max-size="))
+		{
+			options.maxSize = ParseSize(value);
+		}
+		else if (const char* value = valueOf("--min-time="))
+		{
+			options.minSeconds = std::atof(value);
+		}
+		else if (const char* value = valueOf("--filter="))
+		{
+			options.filter = value;
+		}
+		else
+		{
+			std::fprintf(stderr,
+				"Usage: %s [--min-size=1K] [--max-size=32M] [--min-time=0.5] [--filter=<substring>]\n"
+				"  Sizes grow 32 times from min to max, up to 1G.\n",
+				argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+inline int RunBenchmarks(int argc, char* argv[], const std::vector<BenchmarkCase>& cases)
+{
+	/*
+	 * Runs every case on every corpus kind and size and prints a table.
+	 * Each measurement repeats lexing until `minSeconds` passed
+	 *  and reports the best run; allocations are counted on the first run.
+	 */
+	using Clock = std::chrono::steady_clock;
+	static const CorpusKind KINDS[] = {
+		CorpusKind::Numbers, CorpusKind::Ids, CorpusKind::Operators, CorpusKind::Whitespace, CorpusKind::Errors,
+	};
+
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	std::printf("%-28s %-11s %8s %10s %12s %13s %12s\n",
+		"case", "corpus", "size", "MB/s", "Mtokens/s", "allocs/token", "peak RSS MB");
+	for (CorpusKind kind : KINDS)
+	{
+		for (size_t size = options.minSize; size <= options.maxSize; size = size <= options.maxSize / 32 ? size * 32 : options.maxSize + 1)
+		{
+			const std::string text = GenerateCorpus(kind, size);
+			for (const BenchmarkCase& benchmark : cases)
+			{
+				const std::string title = benchmark.name + "/" + GetCorpusName(kind) + "/" + FormatSize(size);
+				if (title.find(options.filter) == std::string::npos)
+				{
+					continue;
+				}
+
+				const size_t allocationsBefore = AllocationCount().load();
+				Clock::time_point start = Clock::now();
+				const size_t tokens = benchmark.lex(text);
+				double best = std::chrono::duration<double>(Clock::now() - start).count();
+				const size_t allocations = AllocationCount().load() - allocationsBefore;
+
+				double total = best;
+				while (total < options.minSeconds)
+				{
+					start = Clock::now();
+					benchmark.lex(text);
+					const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+					best = std::min(best, seconds);
+					total += seconds;
+				}
+				best = std::max(best, 1e-9);
+
+				std::printf("%-28s %-11s %8s %10.1f %12.2f %13.3f %12.1f\n",
+					benchmark.name.c_str(),
+					GetCorpusName(kind),
+					FormatSize(size).c_str(),
+					size / best / (1024 * 1024),
+					tokens / best / 1e6,
+					tokens ? static_cast<double>(allocations) / tokens : 0.0,
+					GetPeakRss() / (1024.0 * 1024));
+				std::fflush(stdout);
+			}
+		}
+	}
+	return 0;
+}
+
+}
+
+#if defined(CALC_BENCH_IMPLEMENT)
+void* operator new(std::size_t size)
+{
+	calc_bench::AllocationCount().fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+#endif
@@ -0,0 +1,166 @@
+#include "KeywordTable.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace calc
+{
+namespace
+{
+// Gives up on pathological inputs instead of searching forever.
+constexpr uint32_t MAX_SEED = 1u << 24;
+
+bool IsIdStart(char ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+}
+
+// Lexers look up keywords only among TT_ID tokens,
+//  so keyword must match [a-zA-Z_][a-zA-Z0-9_]* to ever be found.
+bool IsIdentifier(std::string_view text)
+{
+	if (text.empty() || !IsIdStart(text.front()))
+	{
+		return false;
+	}
+	return std::all_of(text.begin() + 1, text.end(), [](char ch) {
+		return IsIdStart(ch) || (ch >= '0' && ch <= '9');
+	});
+}
+}
+
+KeywordTable::KeywordTable(const std::vector<Keyword>& keywords)
+{
+	/*
+	 * Builds table with hash and displace algorithm:
+	 * 1) distributes keywords into buckets by hash with seed 0
+	 * 2) for buckets from largest to smallest, searches seed which
+	 *    puts all bucket keywords into free slots
+	 * Lookup then hashes text with seed 0 to find bucket
+	 *  and with bucket seed to find the only slot to compare.
+	 */
+	if (keywords.empty())
+	{
+		return;
+	}
+	std::vector<std::string_view> texts;
+	for (const Keyword& keyword : keywords)
+	{
+		if (keyword.text.empty())
+		{
+			throw std::invalid_argument("keyword must not be empty");
+		}
+		if (!IsIdentifier(keyword.text))
+		{
+			throw std::invalid_argument("keyword " + keyword.text + " is not an identifier");
+		}
+		const size_t type = keyword.type;
+		if (type < FIRST_CUSTOM_TOKEN || type > LAST_CUSTOM_TOKEN)
+		{
+			throw std::invalid_argument("invalid token type for keyword " + keyword.text);
+		}
+		texts.push_back(keyword.text);
+	}
+	std::sort(texts.begin(), texts.end());
+	const auto duplicate = std::adjacent_find(texts.begin(), texts.end());
+	if (duplicate != texts.end())
+	{
+		throw std::invalid_argument("duplicate keyword " + std::string(*duplicate));
+	}
+
+	const size_t count = keywords.size();
+	m_seeds.assign(std::max<size_t>(1, count / 4), 0);
+	m_slots.assign(count + count / 4 + 1, Slot{});
+
+	std::vector<std::vector<size_t>> buckets(m_seeds.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		buckets[Hash(keywords[i].text, 0) % buckets.size()].push_back(i);
+	}
+	std::vector<size_t> order(buckets.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return buckets[a].size() > buckets[b].size();
+	});
+
+	std::vector<bool> used(m_slots.size(), false);
+	std::vector<size_t> placed;
+	for (const size_t bucket : order)
+	{
+		const std::vector<size_t>& items = buckets[bucket];
+		if (items.empty())
+		{
+			break;
+		}
+		for (uint32_t seed = 1;; ++seed)
+		{
+			if (seed == MAX_SEED)
+			{
+				throw std::runtime_error("cannot build keyword table");
+			}
+			placed.clear();
+			for (const size_t item : items)
+			{
+				const size_t slot = Hash(keywords[item].text, seed) % m_slots.size();
+				if (used[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end())
+				{
+					break;
+				}
+				placed.push_back(slot);
+			}
+			if (placed.size() == items.size())
+			{
+				m_seeds[bucket] = seed;
+				break;
+			}
+		}
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			const Keyword& keyword = keywords[items[i]];
+			used[placed[i]] = true;
+			m_slots[placed[i]] = Slot{ static_cast<uint32_t>(m_texts.size()),
+				static_cast<uint32_t>(keyword.text.size()), keyword.type };
+			m_texts += keyword.text;
+		}
+	}
+	m_size = count;
+}
+
+TokenType KeywordTable::Find(std::string_view text) const
+{
+	if (m_size == 0)
+	{
+		return TT_ID;
+	}
+	const uint32_t seed = m_seeds[Hash(text, 0) % m_seeds.size()];
+	const Slot& slot = m_slots[Hash(text, seed) % m_slots.size()];
+	if (slot.length == text.size() && m_texts.compare(slot.offset, slot.length, text) == 0)
+	{
+		return slot.type;
+	}
+	return TT_ID;
+}
+
+size_t KeywordTable::Size() const
+{
+	return m_size;
+}
+
+uint32_t KeywordTable::Hash(std::string_view text, uint32_t seed)
+{
+	// FNV-1a with seeded basis and murmur3 finalizer for better avalanche.
+	uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+	for (const char ch : text)
+	{
+		hash ^= static_cast<uint8_t>(ch);
+		hash *= 16777619u;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Token.h"
+
+namespace calc
+{
+
+struct Keyword
+{
+	std::string text;
+	TokenType type = TT_ID;
+};
+
+/*
+ * Static set of keywords which lexer recognizes among TT_ID tokens.
+ * Uses perfect hash (hash and displace), so lookup takes two hashes
+ *  and one string compare regardless of table size,
+ *  and keywords don't add states to lexer.
+ * Table is immutable after construction and can be shared by threads.
+ */
+class KeywordTable
+{
+public:
+	KeywordTable() = default;
+
+	// Throws std::invalid_argument on empty or duplicate keyword,
+	//  on keyword which cannot be read as identifier
+	//  and on type outside [FIRST_CUSTOM_TOKEN, LAST_CUSTOM_TOKEN].
+	explicit KeywordTable(const std::vector<Keyword>& keywords);
+
+	// Returns keyword type or TT_ID if `text` is not a keyword.
+	TokenType Find(std::string_view text) const;
+
+	size_t Size() const;
+
+private:
+	struct Slot
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
+		TokenType type = TT_ID;
+	};
+
+	static uint32_t Hash(std::string_view text, uint32_t seed);
+
+	std::vector<uint32_t> m_seeds; // displacement seed per bucket
+	std::vector<Slot> m_slots;
+	std::string m_texts; // all keywords, slots refer to them
+	size_t m_size = 0;
+};
+
+}
@@ -0,0 +1,43 @@
+#include "LineIndex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace calc
+{
+
+LineIndex::LineIndex(std::string_view sources)
+	: m_sources(sources)
+{
+}
+
+SourceLocation LineIndex::GetLocation(size_t offset) const
+{
+	std::call_once(m_buildOnce, &LineIndex::Build, this);
+	// First line start which is greater than offset follows the line of offset.
+	const auto next = std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset);
+	const size_t line = static_cast<size_t>(next - m_lineStarts.begin());
+	return SourceLocation{ line, offset - m_lineStarts[line - 1] + 1 };
+}
+
+void LineIndex::Build() const
+{
+	/*
+	 * Finds all line feeds with memchr, which standard libraries
+	 *  implement with vector instructions.
+	 */
+	m_lineStarts.push_back(0);
+	const char* begin = m_sources.data();
+	const char* end = begin + m_sources.size();
+	for (const char* it = begin; it != end;)
+	{
+		const void* found = std::memchr(it, '\n', static_cast<size_t>(end - it));
+		if (found == nullptr)
+		{
+			break;
+		}
+		it = static_cast<const char*>(found) + 1;
+		m_lineStarts.push_back(static_cast<size_t>(it - begin));
+	}
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace calc
+{
+
+struct SourceLocation
+{
+	size_t line = 1;   // 1-based line number
+	size_t column = 1; // 1-based column, counted in bytes
+};
+
+/*
+ * Converts token offsets into line and column.
+ * Table of line starts is built once on the first lookup,
+ *  so lexing itself never pays for locations.
+ * Lookups may run concurrently from several threads.
+ */
+class LineIndex
+{
+public:
+	explicit LineIndex(std::string_view sources);
+
+	SourceLocation GetLocation(size_t offset) const;
+
+private:
+	void Build() const;
+
+	std::string_view m_sources;
+	mutable std::once_flag m_buildOnce;
+	mutable std::vector<size_t> m_lineStarts;
+};
+
+}
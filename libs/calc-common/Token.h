@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace calc
+{
+
+// Fixed underlying type makes every value up to LAST_CUSTOM_TOKEN valid.
+enum TokenType : uint8_t
+{
+	TT_END = 0,
+	TT_ERROR,
+	TT_NUMBER,
+	TT_ID,
+	TT_PLUS,
+	TT_MINUS,
+	TT_ASTERISK,
+	TT_SLASH,
+	TT_EQUAL,
+	TT_OPEN_BRACKET,
+	TT_CLOSE_BRACKET,
+};
+
+// Range of token types for keywords and for rules added at runtime.
+// Custom tokens keep matched text as value.
+constexpr size_t FIRST_CUSTOM_TOKEN = 64;
+constexpr size_t LAST_CUSTOM_TOKEN = 255;
+
+inline bool HasValue(TokenType type)
+{
+	return type == TT_NUMBER || type == TT_ID || type == TT_ERROR
+		|| static_cast<size_t>(type) >= FIRST_CUSTOM_TOKEN;
+}
+
+/*
+ * Token value is a slice of lexer sources, so token must not outlive them.
+ * Use OwnedToken when token must be stored after sources are released.
+ */
+struct Token
+{
+	TokenType type = TT_END;
+	std::optional<std::string_view> value;
+	size_t offset = 0; // byte offset of token start in lexer sources
+};
+
+struct OwnedToken
+{
+	TokenType type = TT_END;
+	std::optional<std::string> value;
+	size_t offset = 0;
+
+	OwnedToken() = default;
+
+	explicit OwnedToken(const Token& token)
+		: type(token.type)
+		, offset(token.offset)
+	{
+		if (token.value)
+		{
+			value.emplace(*token.value);
+		}
+	}
+};
+
+}
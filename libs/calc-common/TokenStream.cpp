@@ -0,0 +1,87 @@
+#include "TokenStream.h"
+
+namespace calc
+{
+void TokenStream::Clear()
+{
+	m_types.clear();
+	m_offsets.clear();
+	m_lengths.clear();
+}
+
+void TokenStream::Reserve(size_t count)
+{
+	m_types.reserve(count);
+	m_offsets.reserve(count);
+	m_lengths.reserve(count);
+}
+
+void TokenStream::Push(TokenType type, uint32_t offset, uint32_t length)
+{
+	m_types.push_back(static_cast<uint8_t>(type));
+	m_offsets.push_back(offset);
+	m_lengths.push_back(length);
+}
+
+void TokenStream::Append(const TokenStream& other, uint32_t offsetShift)
+{
+	m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+	m_lengths.insert(m_lengths.end(), other.m_lengths.begin(), other.m_lengths.end());
+	m_offsets.reserve(m_offsets.size() + other.m_offsets.size());
+	for (uint32_t offset : other.m_offsets)
+	{
+		m_offsets.push_back(offset + offsetShift);
+	}
+}
+
+size_t TokenStream::Size() const
+{
+	return m_types.size();
+}
+
+bool TokenStream::Empty() const
+{
+	return m_types.empty();
+}
+
+TokenType TokenStream::GetType(size_t index) const
+{
+	return static_cast<TokenType>(m_types[index]);
+}
+
+uint32_t TokenStream::GetOffset(size_t index) const
+{
+	return m_offsets[index];
+}
+
+uint32_t TokenStream::GetLength(size_t index) const
+{
+	return m_lengths[index];
+}
+
+const std::vector<uint8_t>& TokenStream::GetTypes() const
+{
+	return m_types;
+}
+
+const std::vector<uint32_t>& TokenStream::GetOffsets() const
+{
+	return m_offsets;
+}
+
+const std::vector<uint32_t>& TokenStream::GetLengths() const
+{
+	return m_lengths;
+}
+
+Token TokenStream::GetToken(size_t index, std::string_view sources) const
+{
+	const TokenType type = GetType(index);
+	if (!HasValue(type))
+	{
+		return Token{ type, std::nullopt, m_offsets[index] };
+	}
+	return Token{ type, sources.substr(m_offsets[index], m_lengths[index]), m_offsets[index] };
+}
+
+}
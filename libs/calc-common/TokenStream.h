@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Token.h"
+
+namespace calc
+{
+
+/*
+ * Compact token storage: token types, offsets and lengths are kept
+ *  in parallel arrays, 9 bytes per token without heap blocks for values.
+ * Offsets and lengths are 32-bit, so sources must be less than 4 GiB.
+ */
+class TokenStream
+{
+public:
+	void Clear();
+	void Reserve(size_t count);
+	void Push(TokenType type, uint32_t offset, uint32_t length);
+
+	// Appends all tokens of `other` shifting their offsets by `offsetShift`.
+	void Append(const TokenStream& other, uint32_t offsetShift);
+
+	size_t Size() const;
+	bool Empty() const;
+
+	TokenType GetType(size_t index) const;
+	uint32_t GetOffset(size_t index) const;
+	uint32_t GetLength(size_t index) const;
+
+	const std::vector<uint8_t>& GetTypes() const;
+	const std::vector<uint32_t>& GetOffsets() const;
+	const std::vector<uint32_t>& GetLengths() const;
+
+	// Restores token, value is sliced from the same sources which were lexed.
+	Token GetToken(size_t index, std::string_view sources) const;
+
+private:
+	std::vector<uint8_t> m_types;
+	std::vector<uint32_t> m_offsets;
+	std::vector<uint32_t> m_lengths;
+};
+
+}
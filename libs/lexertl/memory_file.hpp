@@ -77,7 +77,11 @@ public:
                 _data = static_cast<char_type *>(::MapViewOfFile
                     (_fmh, FILE_MAP_READ, 0, 0, 0));
 
-                if (_data) _size = ::GetFileSize(_fh, 0) / sizeof(char_type);
+                LARGE_INTEGER size_;
+
+                if (_data && ::GetFileSizeEx(_fh, &size_))
+                    _size = static_cast<std::size_t>(size_.QuadPart) /
+                        sizeof(char_type);
             }
         }
 #else
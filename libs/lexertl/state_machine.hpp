@@ -74,7 +74,8 @@ public:
         for (id_type i_ = 0; i_ < dfas_; ++i_)
         {
             const id_type dfa_alphabet_ = _internals._dfa_alphabet[i_];
-            id_type_vector *dfa_ = _internals._dfa[i_];
+            // Local patch: ptr_vector::operator[] returns a reference.
+            id_type_vector *dfa_ = &_internals._dfa[i_];
 
             if (dfa_alphabet_ != 0)
             {